@@ -13,7 +13,11 @@
 enum class subcommand : uint8_t
 {
     build,
-    search
+    search,
+    serve,
+    update,
+    merge,
+    merge_results
 };
 
 struct parse_result
@@ -4,11 +4,17 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <string>
 #include <vector>
 
+#include <hibf/misc/insert_iterator.hpp>
+
 #include <fpgalign/config.hpp>
 #include <fpgalign/meta.hpp>
+#include <fpgalign/utility/container.hpp>
 
 namespace build
 {
@@ -16,7 +22,28 @@ namespace build
 std::vector<std::vector<std::string>> parse_input(config const & config);
 
 void build(config const & config);
-void ibf(config const & config, meta & meta);
-void fmindex(config const & config, meta & meta);
+// If `container` is nullptr, each part of the index is stored in a separate file.
+void ibf(config const & config, meta & meta, utility::container_writer * container);
+void fmindex(config const & config, meta & meta, utility::container_writer * container);
+
+// A shard (`--bins`) stores the FM-Indices and references of its bins like a full build. Its IBF has all bins, but only
+// those of the shard are filled. The IBF and meta data are stored as `<output>.<begin>-<end>.ibf` and `.meta`, which
+// are combined by merge.
+bool is_shard(config const & config);
+// The end of the shard's bin range, clamped to the number of bins.
+size_t shard_end(config const & config, meta const & meta);
+std::filesystem::path shard_prefix(config const & config, meta const & meta);
+
+// Combines the shards of the index `config.output_path`.
+void merge(config const & config);
+
+// Inserts the minimisers of the user bin `user_bin_id`, using the k-mer and window size of `meta`.
+void insert_minimisers(meta const & meta, size_t const user_bin_id, seqan::hibf::insert_iterator it);
+// Builds and stores the FM-Index and references of a single bin. `reference` is a buffer.
+void fmindex(config const & config,
+             meta & meta,
+             size_t const bin,
+             std::vector<std::vector<uint8_t>> & reference,
+             utility::container_writer * container);
 
 } // namespace build
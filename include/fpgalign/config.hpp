@@ -4,21 +4,55 @@
 
 #pragma once
 
-#include <cstdint>    // for uint8_t, uint16_t, uint32_t
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uint8_t, uint16_t, uint32_t, uint64_t
 #include <filesystem> // for path
+#include <limits>     // for numeric_limits
+#include <vector>     // for vector
 
 struct config
 {
     uint8_t kmer_size{20u};
     uint32_t window_size{kmer_size};
+    // A gapped shape, see contrib::minimiser_hash_parameters. 0 is the ungapped shape of size `kmer_size`.
+    uint64_t shape{0u};
+    // If not 0, open syncmers with s-mers of this size are used instead of minimisers.
+    uint8_t syncmer_size{0u};
 
     uint8_t hash_count{2u};
     double fpr{0.05};
+    // Build a hierarchical IBF instead of an IBF.
+    bool hibf{false};
+    // Sharded builds: all shards use IBF bins that fit this many minimisers.
+    size_t max_elements{0u};
+
+    // Only the bins in [bins_begin, bins_end) are built or searched.
+    size_t bins_begin{0u};
+    size_t bins_end{std::numeric_limits<size_t>::max()};
+    // merge-results: the outputs of the search shards.
+    std::vector<std::filesystem::path> result_paths{};
 
     std::filesystem::path input_path{};
     std::filesystem::path output_path{};
     std::filesystem::path query_path{};
+    std::filesystem::path query2_path{};
+    // serve: the Unix domain socket that accepts search jobs.
+    std::filesystem::path socket_path{};
+    // serve: the number of FM-Indices that stay loaded between jobs.
+    size_t cached_indices{16u};
+    bool single_file{false};
     uint8_t errors{0u};
     uint16_t threads{1u};
     size_t queue_capacity{1u};
+    size_t batch_size{16u};
+    size_t max_insert_size{1000u};
+    bool collapse_duplicates{false};
+    bool bin_major{false};
+    bool numa{false};
+    bool huge_pages{false};
+    bool verbose{false};
+
+    // Seed-and-extend is used if seed_length != 0.
+    uint32_t seed_length{0u};
+    double error_rate{0.1};
 };
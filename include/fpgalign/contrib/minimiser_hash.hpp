@@ -14,7 +14,8 @@
 #include <hibf/contrib/std/detail/adaptor_from_functor.hpp>
 // IWYU pragma: end_exports
 
-// Same as seqan3::views::minimiser_hash, but optimized for dna4, with integrated adjust_seed
+// Same as seqan3::views::minimiser_hash, but optimized for dna4, with integrated adjust_seed.
+// Additionally supports gapped shapes and open syncmers.
 
 namespace contrib
 {
@@ -23,6 +24,12 @@ struct minimiser_hash_parameters
 {
     uint8_t kmer_size{};
     uint32_t window_size{};
+    // The positions of the k-mer that are hashed, like seqan3::bin_literal: the most significant bit is the first
+    // position. 0 hashes all positions.
+    uint64_t shape{};
+    // If not 0, open syncmers are sampled instead of minimisers: each k-mer whose smallest s-mer starts at
+    // (kmer_size - syncmer_size) / 2. The window size must be the k-mer size.
+    uint8_t syncmer_size{};
 };
 
 } // namespace contrib
@@ -62,7 +69,7 @@ public:
     }
 
     basic_iterator<true> begin() const
-        requires std::ranges::view<range_t const> && std::ranges::input_range<range_t const>
+        requires std::ranges::input_range<range_t const> && std::ranges::sized_range<range_t const>
     {
         return {std::ranges::begin(range), std::ranges::size(range), params};
     }
@@ -73,7 +80,7 @@ public:
     }
 
     auto end() const noexcept
-        requires std::ranges::view<range_t const> && std::ranges::input_range<range_t const>
+        requires std::ranges::input_range<range_t const> && std::ranges::sized_range<range_t const>
     {
         return std::default_sentinel;
     }
@@ -104,13 +111,26 @@ public:
 private:
     range_iterator_t range_it{};
 
+    // The values in the window are k-mers, or s-mers for syncmers.
     uint64_t kmer_mask{};
+    uint64_t shape_mask{};
     uint64_t seed{};
 
     uint64_t kmer_value{};
     uint64_t kmer_value_rev{};
     size_t minimiser_position{};
 
+    // Syncmers: where the smallest s-mer of a syncmer starts, and the k-mer that ends at the current position.
+    bool sample_syncmers{};
+    size_t syncmer_offset{};
+    uint64_t syncmer_mask{};
+    uint64_t syncmer_shape_mask{};
+    uint64_t syncmer_seed{};
+    uint64_t syncmer_value{};
+    uint64_t syncmer_value_rev{};
+    int syncmer_rev_shift{};
+    value_type syncmer_hash{};
+
     size_t range_size{};
     size_t range_position{};
 
@@ -139,6 +159,25 @@ private:
         return uint64_t{0x8F3F73B5CF1C9ADEULL} >> (64u - 2u * kmer_size);
     }
 
+    // Each position of the shape covers the two bits of its base.
+    static inline constexpr uint64_t compute_shape_mask(uint8_t const kmer_size, uint64_t const shape)
+    {
+        if (shape == 0u)
+            return compute_mask(kmer_size);
+
+        uint64_t mask{};
+        for (size_t i = 0; i < kmer_size; ++i)
+            if (shape & (uint64_t{1u} << i))
+                mask |= uint64_t{0b11} << (2u * i);
+        return mask;
+    }
+
+    // The size of the values in the window.
+    static inline constexpr uint8_t unit_size(minimiser_hash_parameters const & params)
+    {
+        return params.syncmer_size == 0u ? params.kmer_size : params.syncmer_size;
+    }
+
 public:
     basic_iterator() = default;
     basic_iterator(basic_iterator const &) = default;
@@ -152,9 +191,20 @@ public:
         :
         range_it{it.range_it},
         kmer_mask{it.kmer_mask},
+        shape_mask{it.shape_mask},
         seed{it.seed},
         kmer_value{it.kmer_value},
+        kmer_value_rev{it.kmer_value_rev},
         minimiser_position{it.minimiser_position},
+        sample_syncmers{it.sample_syncmers},
+        syncmer_offset{it.syncmer_offset},
+        syncmer_mask{it.syncmer_mask},
+        syncmer_shape_mask{it.syncmer_shape_mask},
+        syncmer_seed{it.syncmer_seed},
+        syncmer_value{it.syncmer_value},
+        syncmer_value_rev{it.syncmer_value_rev},
+        syncmer_rev_shift{it.syncmer_rev_shift},
+        syncmer_hash{it.syncmer_hash},
         range_size{it.range_size},
         range_position{it.range_position},
         minimiser_value{it.minimiser_value},
@@ -164,10 +214,17 @@ public:
 
     basic_iterator(range_iterator_t range_iterator, size_t const range_size, minimiser_hash_parameters const & params) :
         range_it{std::move(range_iterator)},
-        kmer_mask{compute_mask(params.kmer_size)},
-        seed{compute_seed(params.kmer_size)},
+        kmer_mask{compute_mask(unit_size(params))},
+        shape_mask{params.syncmer_size == 0u ? compute_shape_mask(params.kmer_size, params.shape) : kmer_mask},
+        seed{compute_seed(unit_size(params))},
+        sample_syncmers{params.syncmer_size != 0u},
+        syncmer_offset{(params.kmer_size - unit_size(params)) / 2u},
+        syncmer_mask{compute_mask(params.kmer_size)},
+        syncmer_shape_mask{compute_shape_mask(params.kmer_size, params.shape)},
+        syncmer_seed{compute_seed(params.kmer_size)},
+        syncmer_rev_shift{2 * static_cast<int>(params.kmer_size - 1)},
         range_size{range_size},
-        kmer_rev_shift{2 * static_cast<int>(params.kmer_size - 1)}
+        kmer_rev_shift{2 * static_cast<int>(unit_size(params) - 1)}
     {
         if (range_size < params.window_size)
             range_position = range_size;
@@ -187,22 +244,20 @@ public:
 
     basic_iterator & operator++() noexcept
     {
-        while (!next_minimiser_is_new())
-        {}
+        advance();
         return *this;
     }
 
     basic_iterator operator++(int) noexcept
     {
         basic_iterator tmp{*this};
-        while (!next_minimiser_is_new())
-        {}
+        advance();
         return tmp;
     }
 
     value_type operator*() const noexcept
     {
-        return minimiser_value;
+        return sample_syncmers ? syncmer_hash : minimiser_value;
     }
 
 private:
@@ -215,27 +270,38 @@ private:
     void rolling_hash()
         requires std::same_as<std::ranges::range_value_t<range_t>, uint8_t>
     {
-        uint64_t const new_rank = *range_it;
-
-        kmer_value <<= 2;
-        kmer_value |= new_rank;
-        kmer_value &= kmer_mask;
-
-        kmer_value_rev >>= 2;
-        kmer_value_rev |= (new_rank ^ 0b11) << kmer_rev_shift;
+        rolling_hash(*range_it);
     }
 
     void rolling_hash()
         requires std::same_as<std::ranges::range_value_t<range_t>, seqan3::dna4>
     {
-        uint64_t const new_rank = range_it->to_rank();
+        rolling_hash(range_it->to_rank());
+    }
 
+    void rolling_hash(uint64_t const new_rank)
+    {
         kmer_value <<= 2;
         kmer_value |= new_rank;
         kmer_value &= kmer_mask;
 
         kmer_value_rev >>= 2;
         kmer_value_rev |= (new_rank ^ 0b11) << kmer_rev_shift;
+
+        if (sample_syncmers)
+        {
+            syncmer_value <<= 2;
+            syncmer_value |= new_rank;
+            syncmer_value &= syncmer_mask;
+
+            syncmer_value_rev >>= 2;
+            syncmer_value_rev |= (new_rank ^ 0b11) << syncmer_rev_shift;
+        }
+    }
+
+    uint64_t window_value() const
+    {
+        return std::min<uint64_t>((kmer_value & shape_mask) ^ seed, (kmer_value_rev & shape_mask) ^ seed);
     }
 
     template <pop_first pop>
@@ -249,12 +315,16 @@ private:
         if constexpr (pop == pop_first::yes)
             kmer_values_in_window.pop_front();
 
-        kmer_values_in_window.push_back(std::min<uint64_t>(kmer_value ^ seed, kmer_value_rev ^ seed));
+        kmer_values_in_window.push_back(window_value());
     }
 
     void find_minimiser_in_window()
     {
-        auto minimiser_it = std::ranges::min_element(kmer_values_in_window, std::less_equal<uint64_t>{});
+        // Syncmers must not depend on the preceding sequence. Hence, ties are always resolved to the leftmost s-mer,
+        // like in update_minimiser.
+        auto minimiser_it = sample_syncmers
+                              ? std::ranges::min_element(kmer_values_in_window)
+                              : std::ranges::min_element(kmer_values_in_window, std::less_equal<uint64_t>{});
         minimiser_value = *minimiser_it;
         minimiser_position = std::distance(std::begin(kmer_values_in_window), minimiser_it);
     }
@@ -263,17 +333,34 @@ private:
     {
         // range_it is already at the beginning of the range
         rolling_hash();
-        kmer_values_in_window.push_back(std::min<uint64_t>(kmer_value ^ seed, kmer_value_rev ^ seed));
+        kmer_values_in_window.push_back(window_value());
 
         // After this loop, `kmer_values_in_window` contains the first kmer value of the window.
-        for (size_t i = 1u; i < params.kmer_size; ++i)
+        for (size_t i = 1u; i < unit_size(params); ++i)
             next_window<pop_first::yes>();
 
         // After this loop, `kmer_values_in_window` contains all kmer values of the window.
-        for (size_t i = params.kmer_size; i < params.window_size; ++i)
+        for (size_t i = unit_size(params); i < params.window_size; ++i)
             next_window<pop_first::no>();
 
         find_minimiser_in_window();
+
+        if (sample_syncmers && !is_syncmer())
+            advance();
+    }
+
+    void advance()
+    {
+        if (sample_syncmers)
+        {
+            while (!next_syncmer())
+            {}
+        }
+        else
+        {
+            while (!next_minimiser_is_new())
+            {}
+        }
     }
 
     bool next_minimiser_is_new()
@@ -283,7 +370,33 @@ private:
             return ++range_position; // Return true, but also increment range_position
 
         next_window<pop_first::yes>();
+        return update_minimiser();
+    }
+
+    // The window of syncmers spans one k-mer, and its minimiser is the smallest s-mer.
+    bool next_syncmer()
+    {
+        if (range_position + 1 == range_size)
+            return ++range_position;
+
+        next_window<pop_first::yes>();
+        update_minimiser();
+        return is_syncmer();
+    }
 
+    bool is_syncmer()
+    {
+        if (minimiser_position != syncmer_offset)
+            return false;
+
+        syncmer_hash = std::min<uint64_t>((syncmer_value & syncmer_shape_mask) ^ syncmer_seed,
+                                          (syncmer_value_rev & syncmer_shape_mask) ^ syncmer_seed);
+        return true;
+    }
+
+    // Returns whether the minimiser changed after the window moved.
+    bool update_minimiser()
+    {
         // The minimiser left the window.
         if (minimiser_position == 0)
         {
@@ -328,6 +441,12 @@ struct minimiser_hash_fn
             throw std::invalid_argument{"window_size must be > 0."};
         if (params.window_size < params.kmer_size)
             throw std::invalid_argument{"window_size must be >= kmer_size."};
+        if (params.shape != 0u && (params.shape >> (params.kmer_size - 1u)) != 1u)
+            throw std::invalid_argument{"The shape must span kmer_size positions."};
+        if (params.syncmer_size != 0u && params.syncmer_size >= params.kmer_size)
+            throw std::invalid_argument{"syncmer_size must be < kmer_size."};
+        if (params.syncmer_size != 0u && params.window_size != params.kmer_size)
+            throw std::invalid_argument{"window_size must be kmer_size for syncmers."};
 
         return minimiser_hash{std::forward<range_t>(range), std::move(params)};
     }
@@ -8,6 +8,7 @@
 #include <atomic>             // for atomic, atomic_bool
 #include <cassert>            // for assert
 #include <condition_variable> // for condition_variable
+#include <functional>         // for function
 #include <future>             // for future_errc, future_error
 #include <mutex>              // for mutex, unique_lock, scoped_lock
 #include <optional>           // for optional
@@ -17,7 +18,7 @@
 
 #include <cstddef> // for size_t, ptrdiff_t
 #include <string>  // for char_traits, operator+, basic_string, to_string, string
-#include <utility> // for pair
+#include <utility> // for move, pair
 #include <vector>  // for allocator, move, vector
 
 namespace scq
@@ -28,6 +29,9 @@ struct params
     size_t slots;
     size_t carts;
     size_t capacity;
+    // dequeue(slot_id) and dequeue(slot_range) serve at most this many carts ahead of the oldest full cart before
+    // serving the oldest one. Each cart thus waits for a bounded number of these dequeues.
+    size_t max_bypasses{8u};
 };
 
 struct slots
@@ -50,6 +54,18 @@ struct slot_id
     size_t value;
 };
 
+// The slots [begin, end).
+struct slot_range
+{
+    size_t begin;
+    size_t end;
+
+    bool contains(slot_id const slot) const
+    {
+        return slot.value >= begin && slot.value < end;
+    }
+};
+
 template <typename value_t>
 class slotted_cart_queue;
 
@@ -118,7 +134,8 @@ public:
     slotted_cart_queue(params params) :
         slot_count{params.slots},
         cart_count{params.carts},
-        cart_capacity{params.capacity}
+        cart_capacity{params.capacity},
+        max_bypasses{params.max_bypasses}
     {
         if (cart_count < slot_count)
             throw std::logic_error{"The number of carts must be >= the number of slots."};
@@ -193,57 +210,105 @@ public:
         if (full_queue_was_empty)
             full_cart_queue_empty_or_closed_cv.notify_all();
 
+        if (full_cart.has_value() && full_cart_callback)
+            full_cart_callback(full_cart->first);
+
         if (queue_was_closed)
             throw std::overflow_error{"slotted_cart_queue is already closed."};
     }
 
     cart_future_type dequeue()
     {
-        cart_future_type cart_future{};
+        return dequeue_impl(no_slots, no_slots);
+    }
+
+    // Prefers a full cart of the given slot, e.g., the slot whose data the consumer has already loaded.
+    // If there is none, this is the same as dequeue(). If max_bypasses carts were served ahead of the oldest cart, the
+    // oldest cart is served.
+    cart_future_type dequeue(slot_id preferred)
+    {
+        return dequeue_impl(slot_range{preferred.value, preferred.value + 1u}, no_slots);
+    }
+
+    // Prefers a full cart of any of the given slots, e.g., the slots whose data is local to the consumer.
+    cart_future_type dequeue(slot_range preferred)
+    {
+        return dequeue_impl(preferred, no_slots);
+    }
+
+    // Prefers a full cart of the slot `preferred`, and otherwise one of a slot in `fallback`.
+    cart_future_type dequeue(slot_id preferred, slot_range fallback)
+    {
+        return dequeue_impl(slot_range{preferred.value, preferred.value + 1u}, fallback);
+    }
+
+    // Makes the cart of `slot` available to consumers even if it is not full, e.g., after the last value of the slot
+    // was enqueued.
+    void flush(slot_id slot)
+    {
+        using full_cart_type = typename full_carts_queue_t::full_cart_type;
+
+        bool full_queue_was_empty{};
+        std::optional<full_cart_type> full_cart{};
 
         {
-            std::unique_lock<std::mutex> full_cart_queue_lock(full_cart_queue_mutex);
+            std::unique_lock<std::mutex> cart_management_lock(cart_management_mutex);
 
-            full_cart_queue_empty_or_closed_cv.wait(full_cart_queue_lock,
-                                                    [this]
-                                                    {
-                                                        // wait until first cart is full
-                                                        return !full_carts_queue.empty() || queue_closed == true;
-                                                    });
+            auto slot_cart = cart_slots.slot(slot);
+            if (slot_cart.empty())
+                return;
 
-            if (!full_carts_queue.empty())
-            {
-                auto full_cart = full_carts_queue.dequeue();
-                cart_future.id = full_cart.first;
-                cart_future.memory_region = std::move(full_cart.second);
-                cart_future.cart_queue = this;
-                assert_cart_count_variant();
-            }
+            full_cart = full_carts_queue_t::move_slot_cart_to_full_cart(slot_cart);
         }
 
-        // NOTE: cart memory will be released by notify_processed_cart after cart_future was destroyed
-        return cart_future;
+        {
+            std::unique_lock<std::mutex> full_cart_queue_lock(full_cart_queue_mutex);
+
+            full_queue_was_empty = full_carts_queue.empty();
+            full_carts_queue.enqueue(std::move(*full_cart));
+            assert_cart_count_variant();
+        }
+
+        if (full_queue_was_empty)
+            full_cart_queue_empty_or_closed_cv.notify_all();
+
+        if (full_cart_callback)
+            full_cart_callback(slot);
     }
 
     void close()
     {
+        std::vector<scq::slot_id> moved_slots{};
+
         {
             // this locks the whole queue
             std::scoped_lock lock(cart_management_mutex, full_cart_queue_mutex);
 
             queue_closed = true;
-            cart_slots.move_active_carts_into_full_carts_queue(full_carts_queue);
+            moved_slots = cart_slots.move_active_carts_into_full_carts_queue(full_carts_queue);
             assert_cart_count_variant();
         }
 
         empty_cart_queue_empty_or_closed_cv.notify_all();
         full_cart_queue_empty_or_closed_cv.notify_all();
+
+        if (full_cart_callback)
+            for (slot_id slot : moved_slots)
+                full_cart_callback(slot);
+    }
+
+    // Called with the slot of each cart that becomes full, i.e., that can be dequeued. The callback runs on the thread
+    // that filled the cart, without holding any locks. Must be set before the first enqueue.
+    void on_full_cart(std::function<void(slot_id)> callback)
+    {
+        full_cart_callback = std::move(callback);
     }
 
 private:
     size_t slot_count{};
     size_t cart_count{};
     size_t cart_capacity{};
+    size_t max_bypasses{};
 
     queue_memory_t queue_memory{scq::carts{cart_count}, scq::capacity{cart_capacity}};
     empty_carts_queue_t empty_carts_queue{scq::carts{cart_count}, queue_memory};
@@ -251,6 +316,38 @@ private:
 
     friend cart_future_type;
 
+    static constexpr slot_range no_slots{0u, 0u};
+
+    cart_future_type dequeue_impl(slot_range preferred, slot_range fallback)
+    {
+        bool const has_preference = preferred.begin < preferred.end || fallback.begin < fallback.end;
+        cart_future_type cart_future{};
+
+        {
+            std::unique_lock<std::mutex> full_cart_queue_lock(full_cart_queue_mutex);
+
+            full_cart_queue_empty_or_closed_cv.wait(full_cart_queue_lock,
+                                                    [this]
+                                                    {
+                                                        // wait until first cart is full
+                                                        return !full_carts_queue.empty() || queue_closed == true;
+                                                    });
+
+            if (!full_carts_queue.empty())
+            {
+                auto full_cart = has_preference ? full_carts_queue.dequeue(preferred, fallback, max_bypasses)
+                                                : full_carts_queue.dequeue();
+                cart_future.id = full_cart.first;
+                cart_future.memory_region = std::move(full_cart.second);
+                cart_future.cart_queue = this;
+                assert_cart_count_variant();
+            }
+        }
+
+        // NOTE: cart memory will be released by notify_processed_cart after cart_future was destroyed
+        return cart_future;
+    }
+
     void assert_cart_count_variant()
     {
         empty_carts_queue.check_invariant();
@@ -274,6 +371,7 @@ private:
     }
 
     std::atomic_bool queue_closed{false};
+    std::function<void(slot_id)> full_cart_callback{};
 
     cart_slots_t cart_slots{scq::slots{slot_count}, scq::capacity{cart_capacity}};
 
@@ -372,9 +470,10 @@ struct slotted_cart_queue<value_t>::cart_slots_t
         return {slot_id.value, cart_capacity, &memory_region};
     }
 
-    void move_active_carts_into_full_carts_queue(full_carts_queue_t & full_carts_queue)
+    std::vector<scq::slot_id> move_active_carts_into_full_carts_queue(full_carts_queue_t & full_carts_queue)
     {
         // TODO: if pending slots are more than queue capacity? is that a problem?
+        std::vector<scq::slot_id> moved_slots{};
 
         // put all non-empty / non-full carts into full queue (no element can't be added any more and all pending
         // elements = active to fill elements must be processed)
@@ -384,10 +483,13 @@ struct slotted_cart_queue<value_t>::cart_slots_t
             if (!slot_cart.empty())
             {
                 auto full_cart = full_carts_queue_t::move_slot_cart_to_full_cart(slot_cart);
+                moved_slots.push_back(full_cart.first);
                 full_carts_queue.enqueue(full_cart);
                 full_carts_queue.check_invariant();
             }
         }
+
+        return moved_slots;
     }
 
     size_t cart_capacity{};
@@ -493,6 +595,41 @@ struct slotted_cart_queue<value_t>::full_carts_queue_t
         return tmp;
     }
 
+    // Serves the last cart of a slot in `preferred`, otherwise the last cart of a slot in `fallback`, otherwise the last
+    // cart. The carts are ordered by age, hence serving any cart but the first one bypasses the oldest cart. After
+    // `max_bypasses` bypasses, the oldest cart is served.
+    full_cart_type dequeue(slot_range preferred, slot_range fallback, size_t max_bypasses)
+    {
+        size_t const last = internal_queue.size() - 1u;
+
+        if (bypasses >= max_bypasses)
+            return dequeue_at(0u);
+
+        if (preferred.contains(internal_queue[last].first))
+            return dequeue_at(last);
+
+        std::optional<size_t> fallback_position{};
+        for (size_t i = internal_queue.size(); i-- > 0u;)
+        {
+            if (preferred.contains(internal_queue[i].first))
+                return dequeue_at(i);
+            if (!fallback_position.has_value() && fallback.contains(internal_queue[i].first))
+                fallback_position = i;
+        }
+
+        return dequeue_at(fallback_position.value_or(last));
+    }
+
+    full_cart_type dequeue_at(size_t const position)
+    {
+        --count;
+        bypasses = (position == 0u) ? 0u : bypasses + 1u;
+
+        full_cart_type tmp = std::move(internal_queue[position]);
+        internal_queue.erase(internal_queue.begin() + position);
+        return tmp;
+    }
+
     void check_invariant()
     {
         assert(0 <= count);
@@ -508,6 +645,8 @@ struct slotted_cart_queue<value_t>::full_carts_queue_t
 
     std::atomic<std::ptrdiff_t> count{};
     size_t cart_count{};
+    // The number of carts that were served by dequeue(preferred, fallback, max_bypasses) ahead of the oldest cart.
+    size_t bypasses{};
 
     std::vector<full_cart_type> internal_queue{};
 };
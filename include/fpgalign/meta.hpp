@@ -4,42 +4,74 @@
 
 #pragma once
 
-#include <cstddef> // for size_t
-#include <cstdint> // for uint8_t, uint32_t
-#include <string>  // for basic_string, string
-#include <vector>  // for vector
-
-#include <seqan3/alphabet/nucleotide/dna4.hpp> // for dna4
-#include <seqan3/io/detail/misc.hpp>           // for set_format
-#include <seqan3/io/record.hpp>                // for field, fields
-#include <seqan3/io/sequence_file/input.hpp>   // for sequence_file_input, sequence_file_input_default_traits_dna
+#include <cstddef>   // for size_t
+#include <cstdint>   // for uint8_t, uint32_t, uint64_t
+#include <stdexcept> // for runtime_error
+#include <string>    // for basic_string, string, to_string
+#include <vector>    // for vector
 
 #include <cereal/macros.hpp> // for CEREAL_SERIALIZE_FUNCTION_NAME
 
-struct dna4_traits : seqan3::sequence_file_input_default_traits_dna
-{
-    using sequence_alphabet = seqan3::dna4;
-};
-
-using seqfile_t = seqan3::sequence_file_input<dna4_traits, seqan3::fields<seqan3::field::id, seqan3::field::seq>>;
-using record_t = typename seqfile_t::record_type;
+#include <fpgalign/query_store.hpp> // for query_store
 
 struct meta
 {
+    // Written first, and incremented whenever the serialised fields change. An index with another version must be
+    // rebuilt.
+    static constexpr uint32_t format_version{1u};
+
     uint8_t kmer_size{};
     uint32_t window_size{};
+    // See contrib::minimiser_hash_parameters.
+    uint64_t shape{};
+    uint8_t syncmer_size{};
     size_t number_of_bins{};
+    // Whether the prefilter is a hierarchical IBF (`build --hibf`).
+    bool hierarchical{false};
     std::vector<std::vector<std::string>> bin_paths;
     std::vector<std::vector<std::string>> ref_ids;
+    // The lengths of the references, which are needed for the SAM header even if the references are not loaded.
+    std::vector<std::vector<size_t>> ref_lengths;
     std::vector<std::vector<std::vector<uint8_t>>> references;
-    std::vector<record_t> queries;
+    query_store queries;
+    // For paired-end queries, mate 1 of pair `i` is `queries[i]` and mate 2 is `queries[i + number_of_pairs]`.
+    size_t number_of_pairs{};
+    // If duplicates are collapsed, the first `duplicate_offsets.size() - 1` queries have distinct sequences and are
+    // searched. The queries in [duplicate_offsets[i], duplicate_offsets[i + 1]) have the same sequence as query i.
+    std::vector<size_t> duplicate_offsets;
+
+    // Removes the queries and everything derived from them. A loaded index may be searched several times, see serve.
+    void clear_queries()
+    {
+        queries = {};
+        number_of_pairs = 0u;
+        duplicate_offsets = {};
+    }
+
+    // The number of queries that are searched.
+    size_t number_of_searched_queries() const
+    {
+        return duplicate_offsets.empty() ? queries.size() : duplicate_offsets.size() - 1u;
+    }
 
     template <typename archive_t>
     void CEREAL_SERIALIZE_FUNCTION_NAME(archive_t & archive)
     {
+        uint32_t version{format_version};
+        archive(version);
+        if (version != format_version)
+            throw std::runtime_error{"The index has meta data version " + std::to_string(version) + ", but version "
+                                     + std::to_string(format_version)
+                                     + " is required. Please rebuild the index with this version of FPGAlign."};
+
         archive(kmer_size);
         archive(window_size);
+        archive(shape);
+        archive(syncmer_size);
         archive(number_of_bins);
+        archive(hierarchical);
+        archive(bin_paths);
         archive(ref_ids);
+        archive(ref_lengths);
     }
 };
@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint8_t
+#include <span>        // for span
+#include <string_view> // for string_view
+#include <vector>      // for vector
+
+// All queries in one sequence buffer and one ID buffer. Sequences are stored in the FM-index alphabet (dna4 rank + 1).
+// Query i occupies [offsets[i], offsets[i + 1]) of the respective buffer.
+struct query_store
+{
+    std::vector<uint8_t> sequences;
+    std::vector<char> ids;
+    std::vector<size_t> sequence_offsets{0u};
+    std::vector<size_t> id_offsets{0u};
+
+    size_t size() const
+    {
+        return sequence_offsets.size() - 1u;
+    }
+
+    std::span<uint8_t const> sequence(size_t const i) const
+    {
+        return {sequences.data() + sequence_offsets[i], sequences.data() + sequence_offsets[i + 1u]};
+    }
+
+    std::string_view id(size_t const i) const
+    {
+        return {ids.data() + id_offsets[i], ids.data() + id_offsets[i + 1u]};
+    }
+
+    // Ends a query whose sequence has already been appended to `sequences`.
+    void push_back(std::string_view const id)
+    {
+        ids.insert(ids.end(), id.begin(), id.end());
+        id_offsets.push_back(ids.size());
+        sequence_offsets.push_back(sequences.size());
+    }
+
+    void push_back(std::string_view const id, std::span<uint8_t const> const sequence)
+    {
+        sequences.insert(sequences.end(), sequence.begin(), sequence.end());
+        push_back(id);
+    }
+
+    // The queries in the given order.
+    query_store permuted(std::span<size_t const> const order) const
+    {
+        query_store result{};
+        result.sequences.reserve(sequences.size());
+        result.ids.reserve(ids.size());
+        result.sequence_offsets.reserve(order.size() + 1u);
+        result.id_offsets.reserve(order.size() + 1u);
+
+        for (size_t const i : order)
+            result.push_back(id(i), sequence(i));
+
+        return result;
+    }
+};
@@ -4,29 +4,162 @@
 
 #pragma once
 
-#include <cstddef> // for size_t
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint8_t, uint32_t, uint64_t, int64_t
+#include <filesystem>  // for path
+#include <limits>      // for numeric_limits
+#include <mutex>       // for mutex
+#include <optional>    // for optional
+#include <ostream>     // for ostream
+#include <span>        // for span
+#include <stdexcept>   // for invalid_argument
+#include <string>      // for to_string
+#include <type_traits> // for integral_constant
+#include <utility>     // for integer_sequence, make_integer_sequence
+#include <vector>      // for vector
 
 #include <fpgalign/config.hpp>                     // for config
 #include <fpgalign/contrib/slotted_cart_queue.hpp> // for slotted_cart_queue
 #include <fpgalign/meta.hpp>                       // for meta
+#include <fpgalign/utility/fmindex.hpp>            // for fmindex_cache
+#include <fpgalign/utility/ibf.hpp>                // for prefilter
 
 namespace search
 {
 
+// The search and alignment kernels are instantiated for each error count in [0, max_errors].
+inline constexpr uint8_t max_errors{5u};
+
+// Calls `fn` with `std::integral_constant<uint8_t, errors>`.
+template <typename fn_t>
+void dispatch_errors(uint8_t const errors, fn_t && fn)
+{
+    bool const dispatched = [&]<uint8_t... values>(std::integer_sequence<uint8_t, values...>)
+    {
+        return ((errors == values && (fn(std::integral_constant<uint8_t, values>{}), true)) || ...);
+    }(std::make_integer_sequence<uint8_t, max_errors + 1u>{});
+
+    if (!dispatched)
+        throw std::invalid_argument{"The number of errors must be at most " + std::to_string(max_errors) + "."};
+}
+
+// In seed-and-extend mode, seeds whose diagonals differ by at most the band are chained, and the extension is
+// computed within this band around the diagonal of the chain.
+inline size_t extension_band(config const & config, size_t const query_length)
+{
+    return static_cast<size_t>(config.error_rate * query_length) + 1u;
+}
+
+// Packed into 16 bytes to keep the carts of the alignment_queue small. The limits are checked by search().
 struct alignment_info
 {
+    static constexpr size_t max_query_idx{std::numeric_limits<uint32_t>::max()};
+    static constexpr size_t max_reference_number{std::numeric_limits<uint32_t>::max()};
+    static constexpr size_t max_reference_position{(1ULL << 40) - 1u};
+    static constexpr size_t max_mate_offset{(1ULL << 22) - 1u};
+
     // bin is given via the slot number in the alignment_queue
-    size_t query_idx;
-    size_t reference_number;
-    size_t reference_position;
+    uint32_t query_idx;
+    uint32_t reference_number;
+    uint64_t reference_position : 40;
+    // Paired-end only: query_idx is the pair index, and the hit describes mate 1. Mate 2 is on the opposite strand and
+    // starts at reference_position + mate_offset.
+    int64_t mate_offset : 23;
+    uint64_t reverse_complement : 1;
+};
+
+static_assert(sizeof(alignment_info) == 16u);
+
+// Bin-major mode: The IBF results are spilled to disk, and the FM-index stage visits one bin at a time.
+// A chunk consists of `count` 32-bit query indices at byte `offset` of the spill file.
+struct spill_chunk
+{
+    size_t bin;
+    size_t offset;
+    size_t count;
+};
+
+// Bin-major mode: The references of a bin are loaded with its FM-index and freed once all alignments of the bin are
+// written. The FM-index stage reports how many hits of a bin it enqueued, the alignment stage how many it aligned.
+class bin_references
+{
+public:
+    bin_references(config const & config, meta & meta) :
+        search_config{config},
+        search_meta{meta},
+        states(meta.number_of_bins)
+    {}
+
+    bin_references(bin_references const &) = delete;
+    bin_references & operator=(bin_references const &) = delete;
+
+    // Called by the FM-index stage before the first hit of `bin` is enqueued.
+    void load(size_t const bin);
+    // Called by the FM-index stage after all `hits` hits of `bin` were enqueued.
+    void searched(size_t const bin, size_t const hits);
+    // Called by the alignment stage after the alignments of `hits` hits of `bin` were written.
+    void aligned(size_t const bin, size_t const hits);
+
+private:
+    struct state_t
+    {
+        std::optional<size_t> searched{};
+        size_t aligned{};
+    };
+
+    // Must be called while holding the lock.
+    void free_if_done(size_t const bin);
+
+    ::config const & search_config;
+    ::meta & search_meta;
+    std::mutex mutex{};
+    std::vector<state_t> states;
 };
 
 void search(config const & config);
-void ibf(config const & config, meta & meta, scq::slotted_cart_queue<size_t> & filter_queue);
+// Loads everything but the FM-Indices, which are loaded on demand, and checks the limits of alignment_info.
+void load_index(config const & config, meta & meta, utility::prefilter & bloom_filter);
+// Searches the queries of `config` in a loaded index. SAM is written to `output` if given, and to the output path of
+// `config` otherwise. FM-Indices are taken from `cache` if given, and loaded for this search otherwise.
+void search(config const & config,
+            meta & meta,
+            utility::prefilter const & bloom_filter,
+            std::ostream * output,
+            utility::fmindex_cache * cache);
+// Reads the queries of `config` into `meta`. Called before the stages of the search are started, such that errors in
+// the query files reach the caller.
+void load_queries(config const & config, meta & meta);
+// Loads the index once and answers search jobs sent to a Unix domain socket.
+void serve(config const & config);
+
+void ibf(config const & config,
+         meta & meta,
+         utility::prefilter const & bloom_filter,
+         scq::slotted_cart_queue<size_t> & filter_queue);
+std::vector<spill_chunk> ibf(config const & config,
+                             meta & meta,
+                             utility::prefilter const & bloom_filter,
+                             std::filesystem::path const & spill_path);
 void fmindex(config const & config,
              meta & meta,
              scq::slotted_cart_queue<size_t> & filter_queue,
-             scq::slotted_cart_queue<alignment_info> & alignment_queue);
-void do_alignment(config const & config, meta & meta, scq::slotted_cart_queue<alignment_info> & alignment_queue);
+             scq::slotted_cart_queue<alignment_info> & alignment_queue,
+             utility::fmindex_cache * cache);
+void fmindex(config const & config,
+             meta & meta,
+             std::filesystem::path const & spill_path,
+             std::span<spill_chunk const> chunks,
+             scq::slotted_cart_queue<alignment_info> & alignment_queue,
+             bin_references & references);
+// In bin-major mode, `references` is told about each aligned cart.
+void do_alignment(config const & config,
+                  meta & meta,
+                  scq::slotted_cart_queue<alignment_info> & alignment_queue,
+                  std::ostream * output,
+                  bin_references * references);
+
+// Combines the outputs of search shards (`--bins`). For each read, the records with the fewest errors over all shards
+// are kept. For paired-end reads, both records of the pairs with the fewest errors are kept.
+void merge_results(config const & config);
 
 } // namespace search
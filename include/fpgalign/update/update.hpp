@@ -0,0 +1,26 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <fpgalign/config.hpp>
+#include <fpgalign/meta.hpp>
+
+namespace update
+{
+
+// The bins of the new input whose files differ from `meta` or were modified after `index_time`.
+std::vector<size_t> changed_bins(meta const & meta,
+                                 std::vector<std::vector<std::string>> const & bin_paths,
+                                 std::filesystem::file_time_type const index_time);
+
+// Updates the index `config.output_path` to the bins listed in `config.input_path`.
+void update(config const & config);
+
+} // namespace update
@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <cstddef>     // for size_t
+#include <limits>      // for numeric_limits
+#include <type_traits> // for remove_cvref_t
+
 #include <fmindex-collection/search/SearchNg26.h>
 
 namespace fmc::search_ng26
@@ -40,4 +44,38 @@ void search(index_t const & index,
                       });
 }
 
+// Same as above, but with the number of errors known at compile time.
+// The search schemes are resolved once per thread and instantiation instead of once per query, since the cache of
+// fmindex-collection may be thread-local. Queries usually share their length, hence each thread remembers the
+// partition of the last query length.
+template <size_t maxErrors, bool Edit = true, typename index_t, Sequence query_t, typename delegate_t>
+void fixed_errors_search(index_t const & index, query_t && query, delegate_t && delegate)
+{
+    thread_local auto const & search_scheme = getCachedSearchScheme<Edit>(0, maxErrors, /*.shortLen=*/false);
+    thread_local auto const & short_search_scheme = getCachedSearchScheme<Edit>(0, maxErrors, /*.shortLen=*/true);
+
+    using partition_t = std::remove_cvref_t<decltype(getCachedPartition(size_t{}, size_t{}))>;
+    thread_local size_t last_length{std::numeric_limits<size_t>::max()};
+    thread_local partition_t const * last_partition{nullptr};
+
+    size_t const length = query.size();
+    auto const & scheme = (length == 2) ? short_search_scheme : search_scheme;
+
+    if (length == 2 || length != last_length)
+    {
+        last_partition = &getCachedPartition(scheme[0].pi.size(), length);
+        last_length = (length == 2) ? std::numeric_limits<size_t>::max() : length;
+    }
+
+    search_impl<Edit>(index,
+                      query,
+                      scheme,
+                      *last_partition,
+                      [&](auto cur, size_t e)
+                      {
+                          delegate(cur, e);
+                          return false;
+                      });
+}
+
 } // namespace fmc::search_ng26
@@ -0,0 +1,241 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <array>       // for array
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint32_t, uint64_t
+#include <filesystem>  // for path
+#include <fstream>     // for ifstream, ofstream
+#include <ios>         // for ios, streamsize
+#include <istream>     // for istream
+#include <memory>      // for shared_ptr
+#include <mutex>       // for mutex, scoped_lock
+#include <ostream>     // for ostream
+#include <span>        // for span
+#include <stdexcept>   // for runtime_error
+#include <streambuf>   // for streambuf
+#include <string_view> // for string_view
+#include <vector>      // for vector
+
+#include <cereal/archives/binary.hpp> // for BinaryInputArchive, BinaryOutputArchive
+#include <cereal/details/helpers.hpp> // for Exception
+
+// A single file containing the whole index. Build with `--single-file`, search auto-detects `<prefix>.fpgalign`.
+//
+// Layout:
+//   container_header                     at offset 0
+//   section 0, section 1, ...            each starting at a multiple of `container_alignment`
+//   table of contents                    `section_count` many container_section, at `toc_offset`
+//
+// Each section holds one cereal binary archive and can be loaded with a single seek. The alignment allows to mmap
+// sections. All integers are little-endian, as are the cereal archives.
+namespace utility
+{
+
+inline constexpr std::array<char, 8> container_magic{'F', 'P', 'G', 'A', 'L', 'I', 'G', 'N'};
+// Version 2 adds the format version and the reference lengths to the meta data.
+inline constexpr uint32_t container_version{2u};
+inline constexpr uint64_t container_alignment{4096u};
+
+enum class section_kind : uint32_t
+{
+    meta,
+    ibf,
+    fmindex,
+    reference,
+    hibf
+};
+
+struct container_header
+{
+    std::array<char, 8> magic{};
+    uint32_t version{};
+    uint32_t section_count{};
+    uint64_t toc_offset{};
+    uint64_t toc_checksum{};
+};
+
+struct container_section
+{
+    section_kind kind{};
+    uint32_t reserved{};
+    uint64_t bin{};
+    uint64_t offset{};
+    uint64_t size{};
+    uint64_t checksum{};
+};
+
+// A 64-bit checksum over 8-byte words that can be fed in pieces of any size. Not cryptographic, it only detects
+// truncated or corrupted files.
+class checksum
+{
+public:
+    void update(std::span<char const> const bytes);
+    uint64_t value() const;
+
+private:
+    uint64_t state{0x9E3779B97F4A7C15ULL};
+    uint64_t length{};
+    std::array<char, 8> pending{};
+};
+
+// Forwards writes to `target` and computes their checksum. cereal writes via sputn, hence no buffer is needed.
+class checksum_ostreambuf : public std::streambuf
+{
+public:
+    explicit checksum_ostreambuf(std::streambuf & target) : target{target}
+    {}
+
+    uint64_t size() const
+    {
+        return written;
+    }
+
+    uint64_t value() const
+    {
+        return sum.value();
+    }
+
+protected:
+    std::streamsize xsputn(char const * data, std::streamsize count) override;
+    int_type overflow(int_type c) override;
+
+private:
+    std::streambuf & target;
+    checksum sum{};
+    uint64_t written{};
+};
+
+// Forwards at most `limit` bytes from `target` and computes their checksum. cereal reads via sgetn. Reads beyond the
+// limit fail, such that a corrupted size field cannot make cereal read past the section.
+class checksum_istreambuf : public std::streambuf
+{
+public:
+    checksum_istreambuf(std::streambuf & target, uint64_t const limit) : target{target}, limit{limit}
+    {}
+
+    uint64_t size() const
+    {
+        return read;
+    }
+
+    uint64_t value() const
+    {
+        return sum.value();
+    }
+
+protected:
+    std::streamsize xsgetn(char * data, std::streamsize count) override;
+    int_type underflow() override;
+    int_type uflow() override;
+
+private:
+    std::streambuf & target;
+    uint64_t limit;
+    checksum sum{};
+    uint64_t read{};
+};
+
+std::string_view to_string(section_kind const kind);
+
+// The container for the index prefix `prefix`.
+std::filesystem::path container_path(std::filesystem::path const & prefix);
+
+class container_reader;
+
+class container_writer
+{
+public:
+    explicit container_writer(std::filesystem::path const & path);
+
+    container_writer(container_writer const &) = delete;
+    container_writer & operator=(container_writer const &) = delete;
+
+    // Thread-safe. Sections are written in the order of the calls.
+    template <typename value_t>
+    void store(section_kind const kind, size_t const bin, value_t const & value)
+    {
+        std::scoped_lock lock{mutex};
+        begin_section(kind, bin);
+
+        checksum_ostreambuf buffer{*file.rdbuf()};
+        {
+            std::ostream os{&buffer};
+            cereal::BinaryOutputArchive archive{os};
+            archive(value);
+        }
+
+        end_section(buffer);
+    }
+
+    // Copies a section of another container without deserialising it. Thread-safe.
+    void copy(container_reader const & source, section_kind const kind, size_t const bin);
+
+    // Writes the table of contents and the header. Until then, the file is not recognised as container.
+    void finish();
+
+private:
+    void begin_section(section_kind const kind, size_t const bin);
+    void end_section(checksum_ostreambuf const & buffer);
+
+    std::filesystem::path path;
+    std::ofstream file;
+    std::vector<container_section> sections;
+    std::mutex mutex{};
+};
+
+class container_reader
+{
+public:
+    explicit container_reader(std::filesystem::path path);
+
+    std::filesystem::path const & file_path() const
+    {
+        return path;
+    }
+
+    bool contains(section_kind const kind, size_t const bin) const;
+
+    container_section const & section(section_kind const kind, size_t const bin) const;
+
+    // Thread-safe. Throws if the section is missing or its checksum does not match.
+    template <typename value_t>
+    void load(section_kind const kind, size_t const bin, value_t & value) const
+    {
+        container_section const & entry = section(kind, bin);
+        std::ifstream file{path, std::ios::binary};
+        file.seekg(entry.offset);
+
+        checksum_istreambuf buffer{*file.rdbuf(), entry.size};
+        try
+        {
+            std::istream is{&buffer};
+            cereal::BinaryInputArchive archive{is};
+            archive(value);
+        }
+        catch (cereal::Exception const &)
+        {
+            // A corrupted section usually makes cereal read past its end, which is reported as corruption.
+            verify(entry, buffer);
+            throw;
+        }
+
+        verify(entry, buffer);
+    }
+
+private:
+    void verify(container_section const & entry, checksum_istreambuf const & buffer) const;
+
+    std::filesystem::path path;
+    // Sorted by (kind, bin).
+    std::vector<container_section> sections;
+};
+
+// The container of the index prefix `prefix`, or nullptr if the index consists of separate files. The table of
+// contents is only read again if the container was replaced. Thread-safe.
+std::shared_ptr<container_reader const> open_container(std::filesystem::path const & prefix);
+
+} // namespace utility
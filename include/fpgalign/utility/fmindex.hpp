@@ -4,7 +4,12 @@
 
 #pragma once
 
-#include <cstddef> // for size_t
+#include <cstddef>    // for size_t
+#include <filesystem> // for path
+#include <list>       // for list
+#include <memory>     // for shared_ptr
+#include <mutex>      // for mutex
+#include <utility>    // for pair
 
 #include <fmindex-collection/fmindex/BiFMIndex.h> // for BiFMIndex
 
@@ -13,8 +18,34 @@
 namespace utility
 {
 
+// The file of the FM-Index of bin `id` for the index prefix `path`.
+std::filesystem::path fmindex_path(std::filesystem::path const & path, size_t const id);
+
 void store(fmc::BiFMIndex<5> const & index, config const & config, size_t const id);
 
 void load(fmc::BiFMIndex<5> & index, config const & config, size_t const id);
 
+// Keeps the `capacity` most recently used FM-Indices loaded, such that later searches do not deserialise them again.
+// An evicted index stays alive until its last user releases it. Thread-safe.
+class fmindex_cache
+{
+public:
+    explicit fmindex_cache(size_t const capacity) : capacity{capacity}
+    {}
+
+    fmindex_cache(fmindex_cache const &) = delete;
+    fmindex_cache & operator=(fmindex_cache const &) = delete;
+
+    // The index of bin `id`, which is loaded if it is not cached.
+    std::shared_ptr<fmc::BiFMIndex<5> const> get(config const & config, size_t const id);
+
+private:
+    using entry_t = std::pair<size_t, std::shared_ptr<fmc::BiFMIndex<5> const>>;
+
+    size_t capacity;
+    std::mutex mutex{};
+    // The most recently used index is at the front.
+    std::list<entry_t> entries{};
+};
+
 } // namespace utility
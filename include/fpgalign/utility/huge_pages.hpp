@@ -0,0 +1,48 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <compare> // for operator<=>
+#include <cstddef> // for size_t
+#include <cstdint> // for uintptr_t
+#include <vector>  // for vector
+
+// Transparent huge pages for the IBF and the FM-Indices. Their memory is allocated by hibf and fmindex-collection,
+// hence it is advised after loading instead of using an allocator. This requires THP to be `always` or `madvise` in
+// /sys/kernel/mm/transparent_hugepage/enabled; otherwise, the advice is ignored and small pages are used.
+namespace utility
+{
+
+inline constexpr size_t huge_page_size{2u * 1024u * 1024u};
+
+// Advises the huge pages for the part of [data, data + size) that covers whole huge pages, and collapses it right away
+// if the kernel supports MADV_COLLAPSE (Linux 6.1). Otherwise, khugepaged collapses it in the background.
+void use_huge_pages(void const * data, size_t const size);
+
+// An address range [begin, end) of /proc/self/maps.
+struct mapping
+{
+    uintptr_t begin;
+    uintptr_t end;
+
+    friend auto operator<=>(mapping const &, mapping const &) = default;
+};
+
+// The anonymous, writable mappings of at least `min_size` bytes, sorted by address.
+std::vector<mapping> large_mappings(size_t const min_size);
+
+// For structures whose memory cannot be accessed: `before` are the large_mappings(min_size) taken before the structure
+// was loaded. Only the mappings that are new since then, i.e., the ones allocated for the structure, are advised. The
+// mappings of structures that were loaded earlier are left alone.
+void use_huge_pages_for_new_mappings(std::vector<mapping> const & before, size_t const min_size);
+
+// The amount of memory of the whole process that is backed by huge pages, i.e., AnonHugePages of
+// /proc/self/smaps_rollup. This includes memory that was not advised by FPGAlign.
+size_t huge_page_memory();
+
+// The largest huge_page_memory() right after a call of use_huge_pages or use_huge_pages_for_large_mappings.
+size_t peak_huge_page_memory();
+
+} // namespace utility
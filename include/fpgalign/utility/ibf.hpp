@@ -4,15 +4,32 @@
 
 #pragma once
 
+#include <cstddef>
+#include <variant>
+
+#include <hibf/hierarchical_interleaved_bloom_filter.hpp>
 #include <hibf/interleaved_bloom_filter.hpp>
 
 #include <fpgalign/config.hpp>
+#include <fpgalign/meta.hpp>
 
 namespace utility
 {
 
+// The IBF has one bin size for all bins, which is determined by the largest bin. The hierarchical IBF merges small
+// bins and splits large ones, such that sparse bins do not waste memory.
+using prefilter =
+    std::variant<seqan::hibf::interleaved_bloom_filter, seqan::hibf::hierarchical_interleaved_bloom_filter>;
+
 void store(seqan::hibf::interleaved_bloom_filter const & ibf, config const & config);
+void store(seqan::hibf::hierarchical_interleaved_bloom_filter const & hibf, config const & config);
 
 void load(seqan::hibf::interleaved_bloom_filter & ibf, config const & config);
+void load(seqan::hibf::hierarchical_interleaved_bloom_filter & hibf, config const & config);
+// Loads the kind of prefilter that `meta` specifies.
+void load(prefilter & filter, config const & config, meta const & meta);
+
+// The size of the bit vectors, which dominate the memory of a prefilter, in bytes.
+size_t memory_usage(prefilter const & filter);
 
 } // namespace utility
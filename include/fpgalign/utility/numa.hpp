@@ -0,0 +1,70 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <cstddef> // for size_t
+#include <vector>  // for vector
+
+#include <fpgalign/contrib/slotted_cart_queue.hpp> // for slot_range
+
+// NUMA placement without libnuma. The topology is read from sysfs, threads are pinned with sched_setaffinity, and
+// memory is placed by first touch: memory that a thread pinned to a node touches first is allocated on this node.
+namespace utility
+{
+
+class numa_topology
+{
+public:
+    // The nodes with CPUs that this process may run on. A single node if the system is not NUMA or has no sysfs.
+    static numa_topology const & system();
+
+    size_t node_count() const
+    {
+        return nodes.size();
+    }
+
+    // The bins are split into node_count() contiguous ranges.
+    scq::slot_range bins_of_node(size_t const node, size_t const number_of_bins) const
+    {
+        return {(node * number_of_bins + nodes.size() - 1u) / nodes.size(),
+                ((node + 1u) * number_of_bins + nodes.size() - 1u) / nodes.size()};
+    }
+
+    // The workers are split into node_count() contiguous blocks.
+    size_t node_of_worker(size_t const worker, size_t const number_of_workers) const
+    {
+        return worker * nodes.size() / number_of_workers;
+    }
+
+    // Restricts the calling thread to the CPUs of the node.
+    void pin_to_node(size_t const node) const;
+    // Allows the calling thread to run on all nodes again.
+    void unpin() const;
+
+    // While in scope, new pages of the calling thread are interleaved over all nodes.
+    class scoped_interleave
+    {
+    public:
+        explicit scoped_interleave(numa_topology const & topology);
+        ~scoped_interleave();
+
+        scoped_interleave(scoped_interleave const &) = delete;
+        scoped_interleave & operator=(scoped_interleave const &) = delete;
+
+    private:
+        bool active{false};
+    };
+
+private:
+    struct node
+    {
+        size_t id;
+        std::vector<int> cpus;
+    };
+
+    std::vector<node> nodes;
+};
+
+} // namespace utility
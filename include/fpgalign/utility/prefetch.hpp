@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <condition_variable> // for condition_variable_any
+#include <cstddef>            // for size_t
+#include <deque>              // for deque
+#include <filesystem>         // for path
+#include <memory>             // for shared_ptr
+#include <mutex>              // for mutex
+#include <stop_token>         // for stop_token
+#include <thread>             // for jthread
+#include <vector>             // for vector
+
+#include <fpgalign/config.hpp>            // for config
+#include <fpgalign/utility/container.hpp> // for container_reader
+
+namespace utility
+{
+
+// Reads the FM-Index and the references of requested bins into the page cache on a background thread. A later
+// utility::load of such a bin then does not wait for the disk. Each bin is only read once.
+class index_prefetcher
+{
+public:
+    index_prefetcher(config const & config, size_t const number_of_bins);
+
+    index_prefetcher(index_prefetcher const &) = delete;
+    index_prefetcher & operator=(index_prefetcher const &) = delete;
+
+    // Requests for a bin that was already requested are ignored. Thread-safe.
+    void request(size_t const bin);
+
+private:
+    void run(std::stop_token const & stop_token);
+    void prefetch_bin(size_t const bin) const;
+
+    std::filesystem::path input_path;
+    std::shared_ptr<container_reader const> container{};
+    std::mutex mutex{};
+    std::condition_variable_any condition{};
+    std::deque<size_t> pending{};
+    std::vector<bool> is_requested;
+
+    // Declared last, such that it is stopped and joined before the other members are destroyed.
+    std::jthread worker{};
+};
+
+} // namespace utility
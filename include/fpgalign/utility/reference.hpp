@@ -6,6 +6,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <filesystem>
 #include <vector>
 
 #include <fpgalign/config.hpp>
@@ -13,6 +14,9 @@
 namespace utility
 {
 
+// The file of the references of bin `id` for the index prefix `path`.
+std::filesystem::path reference_path(std::filesystem::path const & path, size_t const id);
+
 void store(std::vector<std::vector<uint8_t>> const & reference, config const & config, size_t const id);
 
 void load(std::vector<std::vector<uint8_t>> & reference, config const & config, size_t const id);
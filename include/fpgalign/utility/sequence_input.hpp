@@ -0,0 +1,116 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <array>              // for array
+#include <condition_variable> // for condition_variable
+#include <cstddef>            // for size_t
+#include <cstdint>            // for uint8_t
+#include <exception>          // for exception_ptr
+#include <filesystem>         // for path
+#include <fstream>            // for ifstream
+#include <functional>         // for function
+#include <istream>            // for istream
+#include <memory>             // for unique_ptr
+#include <mutex>              // for mutex
+#include <ranges>             // for transform
+#include <stop_token>         // for stop_token
+#include <streambuf>          // for streambuf
+#include <string>             // for string
+#include <string_view>        // for string_view
+#include <thread>             // for jthread
+#include <vector>             // for vector
+
+namespace utility
+{
+
+// Decompresses a file on a background thread while the consumer parses the previous chunk.
+// Compression is detected by seqan3. BGZF blocks are additionally decompressed on `bgzf_thread_count` threads.
+// A decompression error is rethrown to the consumer once it has read all data before the error.
+class decompressing_streambuf : public std::streambuf
+{
+public:
+    // Strips the compression extension from `path`.
+    explicit decompressing_streambuf(std::filesystem::path & path);
+
+    decompressing_streambuf(decompressing_streambuf const &) = delete;
+    decompressing_streambuf & operator=(decompressing_streambuf const &) = delete;
+
+protected:
+    int_type underflow() override;
+
+private:
+    static constexpr size_t chunk_size{1ULL << 22};
+
+    void produce(std::stop_token const & stop_token);
+
+    std::string file_name;
+    std::ifstream file;
+    std::unique_ptr<std::istream, std::function<void(std::istream *)>> decompressed;
+
+    // Chunk i is stored in buffers[i % 2].
+    std::array<std::vector<char>, 2> buffers{};
+    std::array<size_t, 2> sizes{};
+    std::mutex mutex{};
+    std::condition_variable_any condition{};
+    size_t filled{};
+    size_t released{};
+    bool in_use{};
+    bool done{};
+    std::exception_ptr error{};
+
+    // Declared last, such that it is stopped and joined before the buffers are destroyed.
+    std::jthread worker{};
+};
+
+// Reads FASTA and FASTQ files. Sequences are encoded in the FM-index alphabet (dna4 rank + 1) while scanning the
+// input, and qualities are skipped. Like seqan3's dna4, characters other than ACGTU are read as A.
+class sequence_input
+{
+public:
+    explicit sequence_input(std::filesystem::path path);
+
+    // Reads the next record and appends its sequence to `sequence`. Returns false if there are no more records.
+    bool next(std::vector<uint8_t> & sequence);
+
+    // The ID of the last record that was read.
+    std::string_view id() const
+    {
+        return current_id;
+    }
+
+private:
+    static constexpr size_t initial_capacity{1ULL << 20};
+
+    // `line` points into `buffer` and is invalidated by the next call.
+    bool read_line(std::string_view & line);
+    bool refill();
+
+    std::filesystem::path format_path;
+    decompressing_streambuf decompressed;
+
+    std::vector<char> buffer;
+    size_t begin{};
+    size_t end{};
+
+    bool is_fastq{};
+    bool has_next_header{};
+    std::string current_id;
+    std::string next_id;
+};
+
+namespace views
+{
+
+// Maps the FM-index alphabet to dna4 ranks, e.g., as input for the minimiser hash.
+inline constexpr auto dna4_rank = std::views::transform(
+    [](uint8_t const fm_rank) -> uint8_t
+    {
+        return fm_rank - 1u;
+    });
+
+} // namespace views
+
+} // namespace utility
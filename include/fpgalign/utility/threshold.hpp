@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#include <threshold/threshold.hpp>
+#include <threshold/threshold_parameters.hpp>
+
+#include <fpgalign/config.hpp>
+
+namespace utility
+{
+
+// The directory next to the index `config.input_path` that holds computed thresholds.
+std::filesystem::path threshold_cache_path(config const & config);
+
+// Probabilistic thresholds are expensive to compute for large windows, but only depend on the parameters. They are
+// read from the cache if present, and otherwise computed and added to the cache. If the cache cannot be written, e.g.,
+// because the index is on a read-only file system, the thresholds are only computed.
+threshold::threshold cached_threshold(threshold::threshold_parameters const & parameters, config const & config);
+
+// Open syncmers are sampled independently of their neighbours. Hence, an error only destroys the syncmers among the
+// k-mers that overlap it, each of which is a syncmer with probability 1 / (k - s + 1). The threshold allows for the
+// number of destroyed syncmers that is not exceeded with probability `parameters.tau`.
+threshold::threshold syncmer_threshold(threshold::threshold_parameters const & parameters, uint8_t const syncmer_size);
+
+} // namespace utility
@@ -2,15 +2,17 @@
 // SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: BSD-3-Clause
 
-#include <algorithm>   // for find_if
-#include <cstddef>     // for size_t
-#include <filesystem>  // for operator<<, operator>>
-#include <iomanip>     // for operator<<, quoted
-#include <istream>     // for operator<<, operator>>
-#include <string>      // for operator+, basic_string, operator==, to_string, char_traits, string
-#include <string_view> // for basic_string_view, operator==, string_view
-#include <utility>     // for move
-#include <vector>      // for vector
+#include <algorithm>    // for find_if
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint8_t
+#include <filesystem>   // for operator<<, operator>>
+#include <iomanip>      // for operator<<, quoted
+#include <istream>      // for operator<<, operator>>
+#include <string>       // for operator+, basic_string, operator==, to_string, char_traits, string
+#include <string_view>  // for basic_string_view, operator==, string_view
+#include <system_error> // for errc
+#include <utility>      // for move
+#include <vector>       // for vector
 
 #include <sharg/auxiliary.hpp>        // for parser_meta_data
 #include <sharg/config.hpp>           // for config
@@ -23,6 +25,37 @@
 #include <fpgalign/argument_parsing.hpp> // for parse_result, subcommand, parse_arguments
 #include <fpgalign/config.hpp>           // for config
 
+// Parses `i..j` into [i, j).
+void parse_bin_range(std::string const & range, config & config)
+{
+    size_t const separator = range.find("..");
+    auto parse = [&](std::string_view const number, size_t & value)
+    {
+        auto const [end, error] = std::from_chars(number.data(), number.data() + number.size(), value);
+        return error == std::errc{} && end == number.data() + number.size() && !number.empty();
+    };
+
+    if (separator == std::string::npos
+        || !parse(std::string_view{range}.substr(0, separator), config.bins_begin)
+        || !parse(std::string_view{range}.substr(separator + 2u), config.bins_end)
+        || config.bins_begin >= config.bins_end)
+        throw sharg::validation_error{"--bins must be of the form i..j with i < j, but is \"" + range + "\"."};
+}
+
+// Parses a shape like `1101` into the bits of contrib::minimiser_hash_parameters::shape. Its length is the k-mer size.
+void parse_shape(std::string const & shape, config & config)
+{
+    if (shape.empty() || shape.size() > 32u || shape.front() != '1' || shape.back() != '1'
+        || shape.find_first_not_of("01") != std::string::npos)
+        throw sharg::validation_error{"--shape must be at most 32 0s and 1s that start and end with a 1, but is \""
+                                      + shape + "\"."};
+
+    config.shape = 0u;
+    for (char const c : shape)
+        config.shape = (config.shape << 1) | (c == '1');
+    config.kmer_size = shape.size();
+}
+
 class positive_integer_validator
 {
 public:
@@ -68,6 +101,12 @@ config parse_arguments(sharg::parser & parser)
                                     .required = true,
                                     .validator = sharg::output_file_validator{
                                         sharg::output_file_open_options::open_or_create}}); // .ibf and .fmindex
+    parser.add_flag(config.single_file,
+                    sharg::config{.short_id = '\0',
+                                  .long_id = "single-file",
+                                  .description = "Stores the whole index in a single file `<output>.fpgalign` instead "
+                                                 "of several files per bin. The search detects this file "
+                                                 "automatically."});
     parser.add_option(config.threads,
                       sharg::config{.short_id = '\0',
                                     .long_id = "threads",
@@ -85,6 +124,25 @@ config parse_arguments(sharg::parser & parser)
                                     .long_id = "window",
                                     .description = "The window size.",
                                     .default_message = "k-mer size"});
+    std::string shape{};
+    parser.add_option(shape,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "shape",
+                                    .description = "A gapped shape, given as 0s and 1s that start and end with a 1, "
+                                                   "e.g., 1101011. Only the positions marked with 1 are hashed, "
+                                                   "hence mismatches at the other positions do not change the k-mer. "
+                                                   "The k-mer size is the length of the shape.",
+                                    .default_message = "ungapped"});
+    parser.add_option(config.syncmer_size,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "syncmer",
+                                    .description = "Samples open syncmers instead of minimisers: the k-mers whose "
+                                                   "smallest s-mer of this size is in their middle. Unlike minimisers, "
+                                                   "syncmers do not depend on the surrounding sequence, such that an "
+                                                   "error changes fewer of them. The k-mer size minus the s-mer size "
+                                                   "must be even. Cannot be combined with --window.",
+                                    .default_message = "0 (minimisers)",
+                                    .validator = sharg::arithmetic_range_validator{0, 31}});
 
     parser.add_subsection("IBF options");
     parser.add_option(config.fpr,
@@ -97,10 +155,62 @@ config parse_arguments(sharg::parser & parser)
                                     .long_id = "hash",
                                     .description = "The number of hash functions to use.",
                                     .validator = sharg::arithmetic_range_validator{1, 5}});
+    parser.add_flag(config.hibf,
+                    sharg::config{.short_id = '\0',
+                                  .long_id = "hibf",
+                                  .description = "Builds a hierarchical IBF instead of an IBF. It needs less memory "
+                                                 "if the bins differ in size, but is slower to query. Prints the size "
+                                                 "of the filter."});
+
+    parser.add_subsection("Sharding options");
+    std::string bin_range{};
+    parser.add_option(bin_range,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "bins",
+                                    .description = "Only builds the bins i, ..., j-1 of the input, given as i..j. "
+                                                   "The shards of an index can be built in parallel, e.g., on "
+                                                   "different nodes, and are combined with `FPGAlign merge`."});
+    parser.add_option(config.max_elements,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "max-elements",
+                                    .description = "The number of minimisers of the largest bin. Determines the IBF "
+                                                   "size and must be the same for all shards. Required for --bins.",
+                                    .validator = positive_integer_validator{}});
 
     parser.parse();
 
-    if (parser.is_option_set("kmer") && !parser.is_option_set("window"))
+    if (parser.is_option_set("bins"))
+    {
+        parse_bin_range(bin_range, config);
+
+        if (config.max_elements == 0u)
+            throw sharg::validation_error{"--bins requires --max-elements."};
+        if (config.single_file)
+            throw sharg::validation_error{"--bins cannot be combined with --single-file."};
+        if (config.hibf)
+            throw sharg::validation_error{"--bins cannot be combined with --hibf."};
+    }
+
+    if (parser.is_option_set("shape"))
+    {
+        uint8_t const kmer_size = config.kmer_size;
+        parse_shape(shape, config);
+        if (parser.is_option_set("kmer") && kmer_size != config.kmer_size)
+            throw sharg::validation_error{"--kmer must be the length of --shape."};
+    }
+
+    if (config.syncmer_size != 0u)
+    {
+        if (parser.is_option_set("window"))
+            throw sharg::validation_error{"--syncmer cannot be combined with --window."};
+        if (config.syncmer_size >= config.kmer_size)
+            throw sharg::validation_error{"--syncmer must be smaller than the k-mer size."};
+        if ((config.kmer_size - config.syncmer_size) % 2 != 0)
+            throw sharg::validation_error{"The k-mer size minus --syncmer must be even, such that both strands sample "
+                                          "the same k-mers."};
+    }
+
+    if ((parser.is_option_set("kmer") || parser.is_option_set("shape")) && !parser.is_option_set("window"))
         config.window_size = config.kmer_size;
     else if (config.window_size < config.kmer_size)
         throw sharg::validation_error{"k-mer size cannot be smaller than window size!"};
@@ -129,11 +239,17 @@ config parse_arguments(sharg::parser & parser)
                                     .description = "Query path",
                                     .required = true,
                                     .validator = sharg::input_file_validator{}});
+    parser.add_option(config.query2_path,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "query2",
+                                    .description = "Query path of the second mates. Enables paired-end mapping. "
+                                                   "The i-th record of --query and --query2 form a pair.",
+                                    .validator = sharg::input_file_validator{}});
     parser.add_option(
         config.output_path,
         sharg::config{.short_id = '\0',
                       .long_id = "output",
-                      .description = "Output path",
+                      .description = "Output path. Writes BAM if the path ends with .bam, and SAM otherwise.",
                       .required = true,
                       .validator = sharg::output_file_validator{sharg::output_file_open_options::open_or_create}});
     parser.add_option(config.threads,
@@ -153,21 +269,281 @@ config parse_arguments(sharg::parser & parser)
                                                    "Results are processed (IBF->FM-Index, FM-Index->Alignment) once "
                                                    "`queue-capacity` many results for a bin have been collected.",
                                     .validator = positive_integer_validator{}});
+    parser.add_option(config.batch_size,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "batch-size",
+                                    .description = "The number of queries that are searched in lock-step in the "
+                                                   "FM-Index. Only used when searching without errors.",
+                                    .advanced = true,
+                                    .validator = positive_integer_validator{}});
+    parser.add_flag(config.collapse_duplicates,
+                    sharg::config{.short_id = '\0',
+                                  .long_id = "collapse-duplicates",
+                                  .description = "Searches and aligns queries with identical sequences only once. "
+                                                 "The output still contains a record for each query."});
+    parser.add_flag(config.bin_major,
+                    sharg::config{.short_id = '\0',
+                                  .long_id = "bin-major",
+                                  .description = "For indices larger than the main memory. The IBF results are "
+                                                 "written to disk first. Afterwards, the bins are searched one at a "
+                                                 "time, and each FM-Index is loaded only once."});
+    parser.add_flag(config.numa,
+                    sharg::config{.short_id = '\0',
+                                  .long_id = "numa",
+                                  .description = "Splits the bins between the NUMA nodes. The FM-Indices and "
+                                                 "references of a bin are allocated on its node and searched by "
+                                                 "threads pinned to this node. The IBF is interleaved over all "
+                                                 "nodes."});
+    parser.add_flag(config.huge_pages,
+                    sharg::config{.short_id = '\0',
+                                  .long_id = "huge-pages",
+                                  .description = "Backs the IBF and the FM-Indices with transparent huge pages to "
+                                                 "reduce TLB misses. Requires transparent huge pages to be enabled "
+                                                 "(`always` or `madvise`). Reports how much memory used huge pages."});
+    parser.add_flag(config.verbose,
+                    sharg::config{.short_id = '\0',
+                                  .long_id = "verbose",
+                                  .description = "Prints the memory usage of the IBF and the throughput of the IBF "
+                                                 "search."});
+
+    parser.add_subsection("Paired-end options");
+    parser.add_option(config.max_insert_size,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "max-insert-size",
+                                    .description = "The maximum distance between the outer ends of two mates.",
+                                    .validator = positive_integer_validator{}});
+
+    parser.add_subsection("Seed-and-extend options");
+    parser.add_option(config.seed_length,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "seed-length",
+                                    .description = "Enables seed-and-extend for long reads. Seeds of this length are "
+                                                   "searched without errors, chained, and extended with a banded "
+                                                   "alignment. The --errors option is not used in this mode. Must "
+                                                   "be in [8, 64].",
+                                    .default_message = "0 (disabled)"});
+    parser.add_option(config.error_rate,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "error-rate",
+                                    .description = "The expected error rate of long reads. Determines the IBF "
+                                                   "threshold and the band of the extension.",
+                                    .validator = sharg::arithmetic_range_validator{0.0, 1.0}});
+
+    parser.add_subsection("Sharding options");
+    std::string bin_range{};
+    parser.add_option(bin_range,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "bins",
+                                    .description = "Only searches the bins i, ..., j-1, given as i..j. Only their "
+                                                   "FM-Indices and references are loaded. The outputs of several "
+                                                   "shards are combined with `FPGAlign merge-results`."});
 
     parser.parse();
 
+    if (parser.is_option_set("bins"))
+        parse_bin_range(bin_range, config);
+
+    if (config.seed_length != 0u && (config.seed_length < 8u || config.seed_length > 64u))
+        throw sharg::validation_error{"--seed-length must be in [8, 64]."};
+
+    if (config.seed_length != 0u && !config.query2_path.empty())
+        throw sharg::validation_error{"Seed-and-extend does not support paired-end queries."};
+
+    if (config.collapse_duplicates && !config.query2_path.empty())
+        throw sharg::validation_error{"Collapsing duplicates is not supported for paired-end queries."};
+
     return config;
 }
 
 } // namespace search
 
+namespace serve
+{
+
+config parse_arguments(sharg::parser & parser)
+{
+    config config{};
+
+    parser.add_subsection("General options");
+    parser.add_option(config.input_path,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "input",
+                                    .description = "Prefix",
+                                    .required = true});
+    parser.add_option(config.socket_path,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "socket",
+                                    .description = "Path of the Unix domain socket to listen on. A job is a list of "
+                                                   "`query <path>`, `query2 <path>`, `errors <n>`, "
+                                                   "`collapse-duplicates <0|1>`, and `seed-length <n>` lines, ended "
+                                                   "by an empty line. The SAM output is sent back. --bin-major is not "
+                                                   "supported, since the server keeps all references loaded.",
+                                    .required = true});
+    parser.add_option(config.threads,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "threads",
+                                    .description = "The number of threads to use.",
+                                    .validator = positive_integer_validator{}});
+    parser.add_option(config.errors,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "errors",
+                                    .description = "The number of errors of jobs that do not specify it.",
+                                    .validator = sharg::arithmetic_range_validator{0, 5}});
+    parser.add_option(config.queue_capacity,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "queue-capacity",
+                                    .description = "See `FPGAlign search --help`.",
+                                    .validator = positive_integer_validator{}});
+    parser.add_option(config.batch_size,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "batch-size",
+                                    .description = "See `FPGAlign search --help`.",
+                                    .advanced = true,
+                                    .validator = positive_integer_validator{}});
+    parser.add_option(config.cached_indices,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "cached-indices",
+                                    .description = "The number of FM-Indices that stay loaded between jobs. Each "
+                                                   "needs about as much memory as the references of its bin. 0 "
+                                                   "loads the FM-Indices for each job."});
+    parser.add_flag(config.collapse_duplicates,
+                    sharg::config{.short_id = '\0',
+                                  .long_id = "collapse-duplicates",
+                                  .description = "The default of jobs that do not specify it. See `FPGAlign search "
+                                                 "--help`."});
+    parser.add_flag(config.numa,
+                    sharg::config{.short_id = '\0',
+                                  .long_id = "numa",
+                                  .description = "Splits the bins between the NUMA nodes. The FM-Indices and "
+                                                 "references of a bin are allocated on its node and searched by "
+                                                 "threads pinned to this node. The IBF is interleaved over all "
+                                                 "nodes."});
+    parser.add_flag(config.huge_pages,
+                    sharg::config{.short_id = '\0',
+                                  .long_id = "huge-pages",
+                                  .description = "See `FPGAlign search --help`."});
+
+
+    parser.add_subsection("Seed-and-extend options");
+    parser.add_option(config.seed_length,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "seed-length",
+                                    .description = "The seed length of jobs that do not specify it. See `FPGAlign "
+                                                   "search --help`.",
+                                    .default_message = "0 (disabled)"});
+    parser.add_option(config.error_rate,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "error-rate",
+                                    .description = "See `FPGAlign search --help`.",
+                                    .validator = sharg::arithmetic_range_validator{0.0, 1.0}});
+
+    parser.parse();
+
+    if (config.seed_length != 0u && (config.seed_length < 8u || config.seed_length > 64u))
+        throw sharg::validation_error{"--seed-length must be in [8, 64]."};
+
+    return config;
+}
+
+} // namespace serve
+
+namespace update
+{
+
+config parse_arguments(sharg::parser & parser)
+{
+    config config{};
+
+    parser.add_subsection("General options");
+    parser.add_option(config.input_path,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "input",
+                                    .description = "A file containing file names. Same format as for build. The "
+                                                   "first bins must be the bins of the index, new bins are appended.",
+                                    .required = true,
+                                    .validator = sharg::input_file_validator{}});
+    parser.add_option(config.output_path,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "index",
+                                    .description = "Prefix of the index to update. The index is updated in place.",
+                                    .required = true});
+    parser.add_option(config.threads,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "threads",
+                                    .description = "The number of threads to use.",
+                                    .validator = positive_integer_validator{}});
+
+    parser.parse();
+
+    return config;
+}
+
+} // namespace update
+
+namespace merge
+{
+
+config parse_arguments(sharg::parser & parser)
+{
+    config config{};
+
+    parser.add_subsection("General options");
+    parser.add_option(config.output_path,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "index",
+                                    .description = "The --output prefix that was used for all shards. The shards are "
+                                                   "replaced by the merged index.",
+                                    .required = true});
+
+    parser.parse();
+
+    return config;
+}
+
+} // namespace merge
+
+namespace merge_results
+{
+
+config parse_arguments(sharg::parser & parser)
+{
+    config config{};
+
+    parser.add_subsection("General options");
+    parser.add_option(config.result_paths,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "input",
+                                    .description = "The SAM or BAM output of a search shard. Can be given multiple "
+                                                   "times.",
+                                    .required = true,
+                                    .validator = sharg::input_file_validator{}});
+    parser.add_option(
+        config.output_path,
+        sharg::config{.short_id = '\0',
+                      .long_id = "output",
+                      .description = "Output path. Writes BAM if the path ends with .bam, and SAM otherwise.",
+                      .required = true,
+                      .validator = sharg::output_file_validator{sharg::output_file_open_options::open_or_create}});
+    parser.add_option(config.threads,
+                      sharg::config{.short_id = '\0',
+                                    .long_id = "threads",
+                                    .description = "The number of threads to use for BGZF compression.",
+                                    .validator = positive_integer_validator{}});
+
+    parser.parse();
+
+    return config;
+}
+
+} // namespace merge_results
+
 parse_result parse_arguments(std::vector<std::string> command_line)
 {
     sharg::parser parser{"FPGAlign", std::move(command_line)};
     parser.info.author = "Enrico Seiler";
     parser.info.version = "1.0.0";
     parser.info.date = "2025-08-15";
-    parser.add_subcommands({"build", "search"});
+    parser.add_subcommands({"build", "search", "serve", "update", "merge", "merge-results"});
 
     parser.parse();
 
@@ -184,6 +560,26 @@ parse_result parse_arguments(std::vector<std::string> command_line)
         result.subcmd = subcommand::search;
         result.cfg = search::parse_arguments(sub_parser);
     }
+    if (sub_parser.info.app_name == std::string_view{"FPGAlign-serve"})
+    {
+        result.subcmd = subcommand::serve;
+        result.cfg = serve::parse_arguments(sub_parser);
+    }
+    if (sub_parser.info.app_name == std::string_view{"FPGAlign-update"})
+    {
+        result.subcmd = subcommand::update;
+        result.cfg = update::parse_arguments(sub_parser);
+    }
+    if (sub_parser.info.app_name == std::string_view{"FPGAlign-merge"})
+    {
+        result.subcmd = subcommand::merge;
+        result.cfg = merge::parse_arguments(sub_parser);
+    }
+    if (sub_parser.info.app_name == std::string_view{"FPGAlign-merge-results"})
+    {
+        result.subcmd = subcommand::merge_results;
+        result.cfg = merge_results::parse_arguments(sub_parser);
+    }
 
     return result;
 }
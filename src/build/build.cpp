@@ -2,17 +2,32 @@
 // SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: BSD-3-Clause
 
-#include <cassert> // for assert
-#include <fstream> // for char_traits, basic_istream, basic_ifstream, getline, operator>>, ifstream
-#include <sstream> // for basic_istringstream
-#include <string>  // for basic_string, string
-#include <utility> // for move
-#include <vector>  // for vector
-
-#include <fpgalign/build/build.hpp>  // for fmindex, ibf, build, parse_input
-#include <fpgalign/config.hpp>       // for config
-#include <fpgalign/meta.hpp>         // for meta
-#include <fpgalign/utility/meta.hpp> // for store
+#include <algorithm>        // for min
+#include <cassert>          // for assert
+#include <cstddef>          // for size_t
+#include <filesystem>       // for path, remove
+#include <fstream>          // for char_traits, basic_istream, basic_ifstream, getline, operator>>, ifstream
+#include <initializer_list> // for initializer_list
+#include <limits>           // for numeric_limits
+#include <optional>         // for optional
+#include <sstream>          // for basic_istringstream
+#include <stdexcept>        // for runtime_error
+#include <string>           // for basic_string, string, to_string
+#include <utility>          // for move
+#include <vector>           // for vector
+
+#include <fmt/format.h> // for format
+
+#include <seqan3/contrib/stream/bgzf_stream_util.hpp> // for bgzf_thread_count
+
+#include <cereal/types/string.hpp> // IWYU pragma: keep
+#include <cereal/types/vector.hpp> // IWYU pragma: keep
+
+#include <fpgalign/build/build.hpp>       // for fmindex, ibf, build, parse_input, is_shard, shard_prefix
+#include <fpgalign/config.hpp>            // for config
+#include <fpgalign/meta.hpp>              // for meta
+#include <fpgalign/utility/container.hpp> // for container_writer, container_path, section_kind
+#include <fpgalign/utility/meta.hpp>      // for store
 
 namespace build
 {
@@ -42,17 +57,90 @@ std::vector<std::vector<std::string>> parse_input(config const & config)
     return result;
 }
 
+namespace
+{
+
+// `search` prefers a container over separate files, and separate files are not overwritten by a container. The files of
+// the other layout are therefore removed, such that the prefix only refers to the new index. Separate files are removed
+// for all bins of the new index and for any further bins of an earlier, larger one.
+void remove_stale_files(config const & config, meta const & meta)
+{
+    if (!config.single_file)
+    {
+        std::filesystem::remove(utility::container_path(config.output_path));
+        return;
+    }
+
+    std::string const prefix = config.output_path.string();
+    for (char const * const extension : {".ibf", ".hibf", ".meta"})
+        std::filesystem::remove(prefix + extension);
+
+    for (size_t bin = 0;; ++bin)
+    {
+        bool const removed_fmindex = std::filesystem::remove(fmt::format("{}.{}.fmindex", prefix, bin));
+        bool const removed_reference = std::filesystem::remove(fmt::format("{}.{}.ref", prefix, bin));
+        if (bin + 1u >= meta.number_of_bins && !removed_fmindex && !removed_reference)
+            break;
+    }
+}
+
+} // namespace
+
 void build(config const & config)
 {
+    // BGZF-compressed references are decompressed on multiple threads.
+    seqan3::contrib::bgzf_thread_count = config.threads;
+
     meta meta{};
     meta.bin_paths = parse_input(config);
     meta.number_of_bins = meta.bin_paths.size();
-    build::ibf(config, meta);
+
+    if (is_shard(config) && config.bins_begin >= meta.number_of_bins)
+        throw std::runtime_error{"--bins starts after the last bin (" + std::to_string(meta.number_of_bins - 1u)
+                                 + ")."};
+
+    remove_stale_files(config, meta);
+
+    std::optional<utility::container_writer> container{};
+    if (config.single_file)
+        container.emplace(utility::container_path(config.output_path));
+    utility::container_writer * const container_ptr = container.has_value() ? &*container : nullptr;
+
+    build::ibf(config, meta, container_ptr);
     assert(meta.kmer_size == config.kmer_size);
     assert(meta.window_size == config.window_size);
-    build::fmindex(config, meta);
+    build::fmindex(config, meta, container_ptr);
+
+    if (container.has_value())
+    {
+        container->store(utility::section_kind::meta, 0u, meta);
+        container->finish();
+    }
+    else if (is_shard(config))
+    {
+        ::config shard_config{config};
+        shard_config.output_path = shard_prefix(config, meta);
+        utility::store(meta, shard_config);
+    }
+    else
+    {
+        utility::store(meta, config);
+    }
+}
+
+bool is_shard(config const & config)
+{
+    return config.bins_begin != 0u || config.bins_end != std::numeric_limits<size_t>::max();
+}
 
-    utility::store(meta, config);
+size_t shard_end(config const & config, meta const & meta)
+{
+    return std::min(config.bins_end, meta.number_of_bins);
+}
+
+std::filesystem::path shard_prefix(config const & config, meta const & meta)
+{
+    return fmt::format("{}.{}-{}", config.output_path.c_str(), config.bins_begin, shard_end(config, meta));
 }
 
 } // namespace build
@@ -2,28 +2,24 @@
 // SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: BSD-3-Clause
 
-#include <algorithm>  // for __copy, copy
 #include <cstddef>    // for size_t
 #include <cstdint>    // for uint8_t
 #include <filesystem> // for path
-#include <iterator>   // for back_insert_iterator, back_inserter
-#include <ranges>     // for transform_view, views, operator|, __pipeable, __fn, operat...
 #include <string>     // for basic_string
-#include <tuple>      // for get
+#include <utility>    // for move
 #include <vector>     // for vector
 
-#include <seqan3/alphabet/concept.hpp> // for to_rank
-#include <seqan3/io/detail/misc.hpp>   // for set_format
-#include <seqan3/io/record.hpp>        // for fields, field
-
 #include <fmindex-collection/fmindex/BiFMIndex.h> // for BiFMIndex
 
-#include <fpgalign/build/build.hpp>       // for fmindex
-#include <fpgalign/config.hpp>            // for config
-#include <fpgalign/meta.hpp>              // for meta, seqfile_t
-#include <fpgalign/utility/fmindex.hpp>   // for store
-#include <fpgalign/utility/reference.hpp> // for store
-#include <std/detail/adaptor_base.hpp>    // for operator|
+#include <cereal/types/vector.hpp> // IWYU pragma: keep
+
+#include <fpgalign/build/build.hpp>            // for fmindex, shard_end
+#include <fpgalign/config.hpp>                 // for config
+#include <fpgalign/meta.hpp>                   // for meta
+#include <fpgalign/utility/container.hpp>      // for container_writer, section_kind
+#include <fpgalign/utility/fmindex.hpp>        // for store
+#include <fpgalign/utility/reference.hpp>      // for store
+#include <fpgalign/utility/sequence_input.hpp> // for sequence_input
 
 namespace build
 {
@@ -31,44 +27,60 @@ namespace build
 void read_reference_into(std::vector<std::vector<uint8_t>> & reference, meta & meta, size_t const i)
 {
     reference.clear();
+    meta.ref_ids[i].clear();
+    meta.ref_lengths[i].clear();
 
     for (auto const & bin_path : meta.bin_paths[i])
     {
-        seqfile_t fin{bin_path};
+        utility::sequence_input fin{bin_path};
+        std::vector<uint8_t> sequence{};
 
-        for (auto && record : fin)
+        // The reader already encodes sequences in the FM-index alphabet.
+        while (fin.next(sequence))
         {
-            meta.ref_ids[i].push_back(record.id());
-            reference.push_back({});
-            std::ranges::copy(record.sequence()
-                                  | std::views::transform(
-                                      [](auto const & in)
-                                      {
-                                          return seqan3::to_rank(in) + 1u;
-                                      }),
-                              std::back_inserter(reference.back()));
+            meta.ref_ids[i].emplace_back(fin.id());
+            meta.ref_lengths[i].push_back(sequence.size());
+            reference.push_back(std::move(sequence));
+            sequence.clear();
         }
     }
 }
 
-void fmindex(config const & config, meta & meta)
+void fmindex(config const & config,
+             meta & meta,
+             size_t const bin,
+             std::vector<std::vector<uint8_t>> & reference,
+             utility::container_writer * container)
+{
+    read_reference_into(reference, meta, bin);
+
+    fmc::BiFMIndex<5> index{reference, /*samplingRate*/ 16, /*threads*/ 1u};
+
+    if (container)
+    {
+        container->store(utility::section_kind::fmindex, bin, index);
+        container->store(utility::section_kind::reference, bin, reference);
+    }
+    else
+    {
+        utility::store(index, config, bin);
+        utility::store(reference, config, bin);
+    }
+}
+
+void fmindex(config const & config, meta & meta, utility::container_writer * container)
 {
     meta.ref_ids.resize(meta.number_of_bins);
+    meta.ref_lengths.resize(meta.number_of_bins);
+    size_t const end = shard_end(config, meta);
 
 #pragma omp parallel num_threads(config.threads)
     {
         std::vector<std::vector<uint8_t>> reference;
 
 #pragma omp for
-        for (size_t i = 0; i < meta.number_of_bins; ++i)
-        {
-            read_reference_into(reference, meta, i);
-
-            fmc::BiFMIndex<5> index{reference, /*samplingRate*/ 16, /*threads*/ 1u};
-
-            utility::store(index, config, i);
-            utility::store(reference, config, i);
-        }
+        for (size_t i = config.bins_begin; i < end; ++i)
+            fmindex(config, meta, i, reference, container);
     }
 }
 
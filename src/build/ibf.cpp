@@ -2,8 +2,9 @@
 // SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: BSD-3-Clause
 
-#include <algorithm>  // for __copy, copy
+#include <algorithm>  // for __copy, copy, sort, unique
 #include <cstddef>    // for size_t
+#include <cstdint>    // for uint8_t, uint64_t
 #include <filesystem> // for path
 #include <functional> // for function
 #include <iomanip>    // for operator<<, quoted
@@ -11,51 +12,112 @@
 #include <string>     // for basic_string, char_traits
 #include <vector>     // for vector
 
-#include <seqan3/io/detail/misc.hpp> // for set_format
-#include <seqan3/io/record.hpp>      // for fields, field
+#include <hibf/config.hpp>                                 // for insert_iterator, config
+#include <hibf/hierarchical_interleaved_bloom_filter.hpp> // for hierarchical_interleaved_bloom_filter
+#include <hibf/interleaved_bloom_filter.hpp>              // for interleaved_bloom_filter, bin_count, bin_index, ...
+#include <hibf/misc/bin_size_in_bits.hpp>                 // for bin_size_in_bits
+#include <hibf/misc/insert_iterator.hpp>                  // for insert_iterator
 
-#include <hibf/config.hpp>                   // for insert_iterator, config
-#include <hibf/interleaved_bloom_filter.hpp> // for interleaved_bloom_filter
-
-#include <fpgalign/build/build.hpp>            // for ibf
+#include <fpgalign/build/build.hpp>            // for ibf, insert_minimisers, is_shard, shard_end, shard_prefix
 #include <fpgalign/colored_strings.hpp>        // for colored_strings
 #include <fpgalign/config.hpp>                 // for config
 #include <fpgalign/contrib/minimiser_hash.hpp> // for minimiser_hash, operator|, minimiser_hash_fn, operator==
-#include <fpgalign/meta.hpp>                   // for meta, seqfile_t
-#include <fpgalign/utility/ibf.hpp>            // for store
+#include <fpgalign/meta.hpp>                   // for meta
+#include <fpgalign/utility/container.hpp>      // for container_writer, section_kind
+#include <fpgalign/utility/ibf.hpp>            // for memory_usage, prefilter, store
+#include <fpgalign/utility/sequence_input.hpp> // for sequence_input, dna4_rank
 
 namespace build
 {
 
-void ibf(config const & config, meta & meta)
+void insert_minimisers(meta const & meta, size_t const user_bin_id, seqan::hibf::insert_iterator it)
 {
-    meta.kmer_size = config.kmer_size;
-    meta.window_size = config.window_size;
+    auto minimiser_view = contrib::views::minimiser_hash({.kmer_size = meta.kmer_size, //
+                                                          .window_size = meta.window_size,
+                                                          .shape = meta.shape,
+                                                          .syncmer_size = meta.syncmer_size});
+    std::vector<uint8_t> sequence{};
 
-    auto get_user_bin_data = [&](size_t const user_bin_id, seqan::hibf::insert_iterator it)
+    for (auto && bin_path : meta.bin_paths[user_bin_id])
     {
-        auto minimiser_view = contrib::views::minimiser_hash({.kmer_size = config.kmer_size, //
-                                                              .window_size = config.window_size});
-
-        for (auto && bin_path : meta.bin_paths[user_bin_id])
+        utility::sequence_input fin{bin_path};
+        while (fin.next(sequence))
         {
-            seqfile_t fin{bin_path};
-            for (auto && record : fin)
+            if (size_t const record_size = sequence.size(); record_size < meta.window_size)
             {
-                if (size_t const record_size = record.sequence().size(); record_size < config.window_size)
-                {
 #pragma omp critical
-                    {
-                        std::cerr << colored_strings::cerr::warning << "File " << std::quoted(bin_path)
-                                  << " contains a sequence of length " << record_size << " (ID=" << record.id()
-                                  << "). This is shorter than the window size (" << config.window_size
-                                  << ") and will result in no k-mers being generated for this sequence. A user bin "
-                                     "without k-mers will result in an error.\n";
-                    }
+                {
+                    std::cerr << colored_strings::cerr::warning << "File " << std::quoted(bin_path)
+                              << " contains a sequence of length " << record_size << " (ID=" << fin.id()
+                              << "). This is shorter than the window size (" << meta.window_size
+                              << ") and will result in no k-mers being generated for this sequence. A user bin "
+                                 "without k-mers will result in an error.\n";
                 }
-                std::ranges::copy(record.sequence() | minimiser_view, it);
+            }
+            std::ranges::copy(sequence | utility::views::dna4_rank | minimiser_view, it);
+            sequence.clear();
+        }
+    }
+}
+
+// All shards use the same IBF size, which is determined by --max-elements. Hence, merge can combine them.
+seqan::hibf::interleaved_bloom_filter shard_ibf(config const & config, meta const & meta)
+{
+    size_t const bin_size = seqan::hibf::bin_size_in_bits({.fpr = config.fpr, //
+                                                           .hash_count = config.hash_count,
+                                                           .elements = config.max_elements});
+    seqan::hibf::interleaved_bloom_filter ibf{seqan::hibf::bin_count{meta.number_of_bins},
+                                              seqan::hibf::bin_size{bin_size},
+                                              seqan::hibf::hash_function_count{config.hash_count}};
+    size_t const end = shard_end(config, meta);
+
+#pragma omp parallel num_threads(config.threads)
+    {
+        std::vector<uint64_t> minimisers{};
+
+#pragma omp for schedule(dynamic)
+        for (size_t i = config.bins_begin; i < end; ++i)
+        {
+            minimisers.clear();
+            insert_minimisers(meta, i, seqan::hibf::insert_iterator{minimisers});
+            std::ranges::sort(minimisers);
+            auto const duplicates = std::ranges::unique(minimisers);
+            minimisers.erase(duplicates.begin(), duplicates.end());
+
+#pragma omp critical
+            {
+                if (minimisers.size() > config.max_elements)
+                    std::cerr << colored_strings::cerr::warning << "Bin " << i << " has " << minimisers.size()
+                              << " minimisers, but --max-elements is " << config.max_elements
+                              << ". Its false positive rate will be higher than " << config.fpr << ".\n";
+
+                for (uint64_t const hash : minimisers)
+                    ibf.emplace(hash, seqan::hibf::bin_index{i});
             }
         }
+    }
+
+    return ibf;
+}
+
+void ibf(config const & config, meta & meta, utility::container_writer * container)
+{
+    meta.kmer_size = config.kmer_size;
+    meta.window_size = config.window_size;
+    meta.shape = config.shape;
+    meta.syncmer_size = config.syncmer_size;
+
+    if (is_shard(config))
+    {
+        ::config shard_config{config};
+        shard_config.output_path = shard_prefix(config, meta);
+        utility::store(shard_ibf(config, meta), shard_config);
+        return;
+    }
+
+    auto get_user_bin_data = [&](size_t const user_bin_id, seqan::hibf::insert_iterator it)
+    {
+        insert_minimisers(meta, user_bin_id, it);
     };
 
     seqan::hibf::config ibf_config{.input_fn = get_user_bin_data,
@@ -64,9 +126,28 @@ void ibf(config const & config, meta & meta)
                                    .maximum_fpr = config.fpr,
                                    .threads = config.threads};
 
-    seqan::hibf::interleaved_bloom_filter ibf{ibf_config};
+    auto store = [&](auto const & filter, utility::section_kind const kind)
+    {
+        if (container)
+            container->store(kind, 0u, filter);
+        else
+            utility::store(filter, config);
+    };
+
+    utility::prefilter filter{};
+    if (config.hibf)
+    {
+        meta.hierarchical = true;
+        store(filter.emplace<seqan::hibf::hierarchical_interleaved_bloom_filter>(ibf_config),
+              utility::section_kind::hibf);
+    }
+    else
+    {
+        store(filter.emplace<seqan::hibf::interleaved_bloom_filter>(ibf_config), utility::section_kind::ibf);
+    }
 
-    utility::store(ibf, config);
+    std::cerr << (config.hibf ? "HIBF" : "IBF") << " size: " << utility::memory_usage(filter) / (1024u * 1024u)
+              << " MiB\n";
 }
 
 } // namespace build
@@ -0,0 +1,165 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <algorithm>    // for min, sort
+#include <charconv>     // for from_chars
+#include <cstddef>      // for size_t
+#include <filesystem>   // for path, directory_iterator, remove
+#include <stdexcept>    // for runtime_error
+#include <string>       // for basic_string, string, to_string
+#include <string_view>  // for string_view
+#include <system_error> // for errc
+#include <utility>      // for move
+#include <vector>       // for vector
+
+#include <hibf/interleaved_bloom_filter.hpp> // for interleaved_bloom_filter
+
+#include <fpgalign/build/build.hpp>  // for merge
+#include <fpgalign/config.hpp>       // for config
+#include <fpgalign/meta.hpp>         // for meta
+#include <fpgalign/utility/ibf.hpp>  // for load, store
+#include <fpgalign/utility/meta.hpp> // for load, store
+
+namespace build
+{
+
+namespace
+{
+
+struct shard
+{
+    size_t begin{};
+    size_t end{};
+    std::filesystem::path prefix{};
+};
+
+// Finds `<prefix>.<begin>-<end>.meta` next to the prefix.
+std::vector<shard> find_shards(std::filesystem::path const & prefix)
+{
+    std::filesystem::path const directory = prefix.has_parent_path() ? prefix.parent_path() : ".";
+    std::string const name = prefix.filename().string() + '.';
+    std::vector<shard> shards{};
+
+    for (auto const & entry : std::filesystem::directory_iterator{directory})
+    {
+        std::string const filename = entry.path().filename().string();
+        if (!filename.starts_with(name) || !filename.ends_with(".meta"))
+            continue;
+
+        std::string_view range{filename};
+        range.remove_prefix(name.size());
+        range.remove_suffix(std::string_view{".meta"}.size());
+
+        shard current{};
+        char const * const last = range.data() + range.size();
+        auto const [separator, begin_error] = std::from_chars(range.data(), last, current.begin);
+        if (begin_error != std::errc{} || separator == last || *separator != '-')
+            continue;
+        auto const [end, end_error] = std::from_chars(separator + 1, last, current.end);
+        if (end_error != std::errc{} || end != last)
+            continue;
+
+        current.prefix = entry.path();
+        current.prefix.replace_extension();
+        shards.push_back(std::move(current));
+    }
+
+    std::sort(shards.begin(),
+              shards.end(),
+              [](shard const & lhs, shard const & rhs)
+              {
+                  return lhs.begin < rhs.begin;
+              });
+
+    return shards;
+}
+
+} // namespace
+
+// The IBFs of the shards have the same size and disjoint filled bins, hence they are combined with a bitwise OR.
+void merge(config const & config)
+{
+    std::vector<shard> const shards = find_shards(config.output_path);
+    if (shards.empty())
+        throw std::runtime_error{"No shards of " + config.output_path.string() + " found."};
+
+    meta merged_meta{};
+    seqan::hibf::interleaved_bloom_filter merged_ibf{};
+    size_t expected_begin{};
+    shard const * previous{nullptr};
+
+    for (shard const & current : shards)
+    {
+        ::config shard_config{config};
+        shard_config.input_path = current.prefix;
+
+        meta shard_meta{};
+        seqan::hibf::interleaved_bloom_filter shard_ibf{};
+        utility::load(shard_meta, shard_config);
+        if (shard_meta.hierarchical)
+            throw std::runtime_error{"The shard " + current.prefix.string() + " has a hierarchical IBF."};
+        utility::load(shard_ibf, shard_config);
+
+        // The shards are sorted by their first bin, hence each shard must start where the previous one ends.
+        if (previous == nullptr && current.begin != 0u)
+            throw std::runtime_error{"The bins 0.." + std::to_string(current.begin)
+                                     + " are not covered by any shard. The first shard is " + current.prefix.string()
+                                     + "."};
+        if (previous != nullptr && current.begin < expected_begin)
+            throw std::runtime_error{"The shards " + previous->prefix.string() + " and " + current.prefix.string()
+                                     + " overlap in the bins " + std::to_string(current.begin) + ".."
+                                     + std::to_string(std::min(expected_begin, current.end)) + "."};
+        if (previous != nullptr && current.begin > expected_begin)
+            throw std::runtime_error{"The bins " + std::to_string(expected_begin) + ".." + std::to_string(current.begin)
+                                     + " between the shards " + previous->prefix.string() + " and "
+                                     + current.prefix.string() + " are not covered by any shard."};
+        expected_begin = current.end;
+        previous = &current;
+
+        if (&current == &shards.front())
+        {
+            merged_meta = std::move(shard_meta);
+            merged_ibf = std::move(shard_ibf);
+            continue;
+        }
+
+        if (shard_meta.number_of_bins != merged_meta.number_of_bins || shard_meta.bin_paths != merged_meta.bin_paths
+            || shard_meta.kmer_size != merged_meta.kmer_size || shard_meta.window_size != merged_meta.window_size
+            || shard_meta.shape != merged_meta.shape || shard_meta.syncmer_size != merged_meta.syncmer_size)
+            throw std::runtime_error{"The shard " + current.prefix.string()
+                                     + " was built from a different input or with different k-mer options."};
+
+        if (shard_ibf.bin_count() != merged_ibf.bin_count() || shard_ibf.bin_size() != merged_ibf.bin_size()
+            || shard_ibf.hash_function_count() != merged_ibf.hash_function_count())
+            throw std::runtime_error{"The IBF of the shard " + current.prefix.string()
+                                     + " has a different size. All shards must use the same --max-elements, --fpr, "
+                                       "and --hash."};
+
+        merged_ibf.raw_data() |= shard_ibf.raw_data();
+        for (size_t i = current.begin; i < current.end; ++i)
+        {
+            merged_meta.ref_ids[i] = std::move(shard_meta.ref_ids[i]);
+            merged_meta.ref_lengths[i] = std::move(shard_meta.ref_lengths[i]);
+        }
+    }
+
+    if (expected_begin != merged_meta.number_of_bins)
+        throw std::runtime_error{"The bins " + std::to_string(expected_begin) + ".."
+                                 + std::to_string(merged_meta.number_of_bins)
+                                 + " are not covered by any shard. The last shard is " + previous->prefix.string()
+                                 + "."};
+
+    utility::store(merged_ibf, config);
+    utility::store(merged_meta, config);
+
+    for (shard const & current : shards)
+    {
+        std::filesystem::path path{current.prefix};
+        std::filesystem::remove(path += ".ibf");
+        path = current.prefix;
+        std::filesystem::remove(path += ".meta");
+    }
+}
+
+} // namespace build
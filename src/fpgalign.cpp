@@ -9,9 +9,10 @@
 #include <vector>    // for vector
 
 #include <fpgalign/argument_parsing.hpp> // for parse_result, subcommand, parse_arguments
-#include <fpgalign/build/build.hpp>      // for build
+#include <fpgalign/build/build.hpp>      // for build, merge
 #include <fpgalign/colored_strings.hpp>  // for colored_strings
-#include <fpgalign/search/search.hpp>    // for search
+#include <fpgalign/search/search.hpp>    // for search, serve, merge_results
+#include <fpgalign/update/update.hpp>    // for update
 
 int main(int argc, char ** argv)
 {
@@ -23,6 +24,14 @@ int main(int argc, char ** argv)
             build::build(result.cfg);
         if (result.subcmd == subcommand::search)
             search::search(result.cfg);
+        if (result.subcmd == subcommand::serve)
+            search::serve(result.cfg);
+        if (result.subcmd == subcommand::update)
+            update::update(result.cfg);
+        if (result.subcmd == subcommand::merge)
+            build::merge(result.cfg);
+        if (result.subcmd == subcommand::merge_results)
+            search::merge_results(result.cfg);
     }
     catch (std::exception const & ext)
     {
@@ -2,23 +2,31 @@
 // SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: BSD-3-Clause
 
-#include <algorithm>  // for find_if
-#include <cstddef>    // for size_t
-#include <cstdint>    // for uint8_t
-#include <filesystem> // for path
-#include <iterator>   // for __next, next
-#include <ranges>     // for transform_view, __fn, tra...
-#include <string>     // for basic_string
-#include <tuple>      // for tuple, tuple_cat, tie
-#include <utility>    // for pair
-#include <vector>     // for vector
+#include <algorithm>   // for find_if, max, min, sort, transform
+#include <atomic>      // for atomic
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint8_t, int32_t, uint32_t
+#include <filesystem>  // for path
+#include <iterator>    // for __next, next, back_inserter
+#include <mutex>       // for mutex, lock_guard
+#include <optional>    // for optional, nullopt
+#include <ostream>     // for ostream
+#include <ranges>      // for reverse, __fn, tra...
+#include <span>        // for span
+#include <string>      // for basic_string
+#include <string_view> // for string_view
+#include <tuple>       // for tuple, tuple_cat, tie
+#include <utility>     // for move, pair
+#include <vector>      // for vector
 
 #include <sharg/std/charconv> // for to_chars
 
 #include <seqan3/alignment/cigar_conversion/cigar_from_alignment.hpp>              // for cigar_from_alignment
+#include <seqan3/alignment/configuration/align_config_band.hpp>                    // for band_fixed_size, lower_d...
 #include <seqan3/alignment/configuration/align_config_edit.hpp>                    // for edit_scheme
 #include <seqan3/alignment/configuration/align_config_gap_cost_affine.hpp>         // for gap_cost_affine
 #include <seqan3/alignment/configuration/align_config_method.hpp>                  // for method_global, free_end_g...
+#include <seqan3/alignment/configuration/align_config_min_score.hpp>               // for min_score
 #include <seqan3/alignment/configuration/align_config_output.hpp>                  // for output_alignment, output_...
 #include <seqan3/alignment/configuration/align_config_scoring_scheme.hpp>          // for scoring_scheme
 #include <seqan3/alignment/matrix/detail/advanceable_alignment_coordinate.hpp>     // for operator==
@@ -26,7 +34,10 @@
 #include <seqan3/alignment/matrix/detail/two_dimensional_matrix_iterator_base.hpp> // for matrix_major_order
 #include <seqan3/alignment/pairwise/align_pairwise.hpp>                            // for align_pairwise
 #include <seqan3/alignment/pairwise/alignment_result.hpp>                          // for alignment_result
+#include <seqan3/alignment/scoring/nucleotide_scoring_scheme.hpp>                  // for nucleotide_scoring_scheme
+#include <seqan3/alignment/scoring/scoring_scheme_base.hpp>                        // for match_score, mismatch_score
 #include <seqan3/alphabet/alphabet_base.hpp>                                       // for operator==, operator<
+#include <seqan3/alphabet/cigar/cigar.hpp>                                         // for cigar
 #include <seqan3/alphabet/nucleotide/dna4.hpp>                                     // for dna4
 #include <seqan3/contrib/std/chunk_view.hpp>                                       // for operator==
 #include <seqan3/contrib/std/detail/adaptor_base.hpp>                              // for operator|
@@ -40,81 +51,463 @@
 #include <seqan3/core/range/detail/adaptor_base.hpp>                               // for operator|
 #include <seqan3/io/detail/misc.hpp>                                               // for set_format
 #include <seqan3/io/record.hpp>                                                    // for field, fields
+#include <seqan3/io/sam_file/format_bam.hpp>                                       // for format_bam
+#include <seqan3/io/sam_file/format_sam.hpp>                                       // for format_sam
 #include <seqan3/io/sam_file/output.hpp>                                           // for sam_file_output
-#include <seqan3/io/sequence_file/record.hpp>                                      // for sequence_record
+#include <seqan3/io/sam_file/sam_flag.hpp>                                         // for sam_flag
+#include <seqan3/io/sam_file/sam_tag_dictionary.hpp>                               // for sam_tag_dictionary, oper...
+#include <seqan3/utility/type_list/type_list.hpp>                                  // for type_list
 
 #include <fpgalign/config.hpp>                     // for config
-#include <fpgalign/contrib/slotted_cart_queue.hpp> // for span, cart_future, slotte...
+#include <fpgalign/contrib/slotted_cart_queue.hpp> // for span, cart_future, slot_range, slotte...
 #include <fpgalign/meta.hpp>                       // for meta
-#include <fpgalign/search/search.hpp>              // for alignment_info, do_alignment
+#include <fpgalign/search/search.hpp>              // for alignment_info, bin_references, dispatch_errors, extensio...
+#include <fpgalign/utility/numa.hpp>               // for numa_topology
 
 namespace search
 {
 
+// The format is chosen by the extension of the output path. BAM output is BGZF-compressed by seqan3, which compresses
+// blocks on `seqan3::contrib::bgzf_thread_count` threads and writes them in order.
 using sam_out_t = seqan3::sam_file_output<seqan3::fields<seqan3::field::seq,
                                                          seqan3::field::id,
+                                                         seqan3::field::flag,
                                                          seqan3::field::ref_id,
                                                          seqan3::field::ref_offset,
                                                          seqan3::field::cigar,
                                                          //    seqan3::field::qual,
-                                                         seqan3::field::mapq>>;
+                                                         seqan3::field::mapq,
+                                                         seqan3::field::mate,
+                                                         seqan3::field::tags>,
+                                          seqan3::type_list<seqan3::format_sam, seqan3::format_bam>,
+                                          std::vector<std::string>>;
 
-void task(meta & meta, size_t const bin, std::span<alignment_info> alignment_infos, sam_out_t & sam_out)
+// Reference ID, position, and template length of the mate.
+using mate_t = std::tuple<std::optional<int32_t>, std::optional<int32_t>, int32_t>;
+static mate_t const no_mate{};
+
+// A record that is buffered by an alignment worker until it is written to the output file.
+// The reference ID is the index of the reference in the header, i.e., over all bins.
+struct sam_entry
+{
+    std::vector<seqan3::dna4> seq;
+    std::string id;
+    seqan3::sam_flag flag;
+    int32_t ref_id;
+    size_t ref_offset;
+    std::vector<seqan3::cigar> cigar;
+    size_t map_qual;
+    mate_t mate;
+    // Written as NM tag.
+    int32_t edit_distance;
+};
+
+// The header lists the references of all searched bins. The references of bin i start at ID offsets[i].
+// With --bins, the header only lists the references of the shard. merge-results matches references by name.
+struct reference_dictionary
 {
-    static seqan3::configuration const align_config =
-        seqan3::align_cfg::method_global{seqan3::align_cfg::free_end_gaps_sequence1_leading{true},
-                                         seqan3::align_cfg::free_end_gaps_sequence2_leading{false},
-                                         seqan3::align_cfg::free_end_gaps_sequence1_trailing{true},
-                                         seqan3::align_cfg::free_end_gaps_sequence2_trailing{false}}
-        | seqan3::align_cfg::edit_scheme | seqan3::align_cfg::output_alignment{}
-        | seqan3::align_cfg::output_begin_position{} | seqan3::align_cfg::output_score{};
-
-    for (auto [query_idx, reference_number, reference_position] : alignment_infos)
+    std::vector<std::string> ids;
+    std::vector<size_t> lengths;
+    std::vector<int32_t> offsets;
+};
+
+reference_dictionary make_reference_dictionary(config const & config, meta const & meta)
+{
+    reference_dictionary dictionary{};
+    dictionary.offsets.reserve(meta.number_of_bins);
+
+    for (size_t bin = 0; bin < meta.number_of_bins; ++bin)
     {
-        auto & seq = meta.queries[query_idx].sequence();
-        auto seq_view = std::views::transform(seq,
-                                              [](seqan3::dna4 const in) -> uint8_t
-                                              {
-                                                  return in.to_rank() + 1u;
-                                              });
-        auto & seq_id = meta.queries[query_idx].id();
-        auto & ref = meta.references[bin][reference_number];
-        auto & ref_id = meta.ref_ids[bin][reference_number];
+        dictionary.offsets.push_back(dictionary.ids.size());
+        if (bin < config.bins_begin || bin >= config.bins_end)
+            continue;
+
+        dictionary.ids.insert(dictionary.ids.end(), meta.ref_ids[bin].begin(), meta.ref_ids[bin].end());
+        dictionary.lengths.insert(dictionary.lengths.end(), meta.ref_lengths[bin].begin(), meta.ref_lengths[bin].end());
+    }
+
+    return dictionary;
+}
+
+// SAM stores the query as it aligns to the forward strand of the reference, i.e., hits on the reverse strand store the
+// reverse complement of the query. In the FM-index alphabet, the complement of `c` is `5 - c`.
+std::span<uint8_t const> oriented_sequence(std::span<uint8_t const> const sequence,
+                                           bool const reverse_complement,
+                                           std::vector<uint8_t> & buffer)
+{
+    if (!reverse_complement)
+        return sequence;
+
+    buffer.resize(sequence.size());
+    std::ranges::transform(sequence | std::views::reverse,
+                           buffer.begin(),
+                           [](uint8_t const fm_rank) -> uint8_t
+                           {
+                               return 5u - fm_rank;
+                           });
+    return buffer;
+}
+
+std::vector<seqan3::dna4> to_dna4(std::span<uint8_t const> const sequence)
+{
+    std::vector<seqan3::dna4> result(sequence.size());
+    std::ranges::transform(sequence,
+                           result.begin(),
+                           [](uint8_t const fm_rank)
+                           {
+                               return seqan3::dna4{}.assign_rank(fm_rank - 1u);
+                           });
+    return result;
+}
+
+seqan3::sam_flag strand_flag(bool const reverse_complement)
+{
+    return reverse_complement ? seqan3::sam_flag::on_reverse_strand : seqan3::sam_flag::none;
+}
+
+struct aligned_query
+{
+    size_t ref_offset;
+    std::vector<seqan3::cigar> cigar;
+    size_t map_qual;
+    int32_t edit_distance;
+
+    // The number of reference characters covered by the alignment.
+    size_t reference_span() const
+    {
+        using namespace seqan3::literals;
+        size_t span{};
+        for (seqan3::cigar const & element : cigar)
+        {
+            auto const operation = element.get<seqan3::cigar::operation>();
+            if (operation == 'M'_cigar_operation || operation == 'D'_cigar_operation)
+                span += element.get<uint32_t>();
+        }
+        return span;
+    }
+};
+
+template <uint8_t errors>
+std::optional<aligned_query>
+align(std::vector<uint8_t> const & ref, std::span<uint8_t const> const seq, size_t const reference_position)
+{
+    // Without errors, every FM-index hit is an exact match of the whole query.
+    // The offset is the same as the one the alignment below reports for an exact match.
+    if constexpr (errors == 0u)
+    {
+        using namespace seqan3::literals;
+        return aligned_query{
+            .ref_offset = reference_position + 2u,
+            .cigar = {seqan3::cigar{static_cast<uint32_t>(seq.size()), 'M'_cigar_operation}},
+            .map_qual = 60u,
+            .edit_distance = 0};
+    }
+    else
+    {
+        // The minimal score lets the edit distance computation stop early once more than `errors` errors are reached.
+        static seqan3::configuration const align_config =
+            seqan3::align_cfg::method_global{seqan3::align_cfg::free_end_gaps_sequence1_leading{true},
+                                             seqan3::align_cfg::free_end_gaps_sequence2_leading{false},
+                                             seqan3::align_cfg::free_end_gaps_sequence1_trailing{true},
+                                             seqan3::align_cfg::free_end_gaps_sequence2_trailing{false}}
+            | seqan3::align_cfg::edit_scheme | seqan3::align_cfg::min_score{-static_cast<int32_t>(errors)}
+            | seqan3::align_cfg::output_alignment{} | seqan3::align_cfg::output_begin_position{}
+            | seqan3::align_cfg::output_score{};
 
+        // An occurrence with `errors` many errors spans at most `length + errors` reference characters.
         size_t const start = reference_position - static_cast<size_t>(reference_position != 0u);
         size_t const length = seq.size();
         auto it = std::ranges::next(ref.begin(), start, ref.end());
-        auto end = std::ranges::next(it, length + 1u, ref.end());
+        auto end = std::ranges::next(it, length + errors + 1u, ref.end());
         std::span ref_text{it, end};
 
-        for (auto && alignment : seqan3::align_pairwise(std::tie(ref_text, seq_view), align_config))
+        for (auto && alignment : seqan3::align_pairwise(std::tie(ref_text, seq), align_config))
+        {
+            return aligned_query{.ref_offset = alignment.sequence1_begin_position() + 2 + start,
+                                 .cigar = seqan3::cigar_from_alignment(alignment.alignment()),
+                                 .map_qual = 60u + alignment.score(),
+                                 .edit_distance = -alignment.score()};
+        }
+
+        return std::nullopt;
+    }
+}
+
+// Collapsed duplicates of a query get a copy of its last record.
+void add_duplicates(meta const & meta, size_t const query_idx, std::vector<sam_entry> & records)
+{
+    if (meta.duplicate_offsets.empty())
+        return;
+
+    for (size_t i = meta.duplicate_offsets[query_idx]; i < meta.duplicate_offsets[query_idx + 1u]; ++i)
+    {
+        sam_entry entry = records.back();
+        entry.id = meta.queries.id(i);
+        records.push_back(std::move(entry));
+    }
+}
+
+template <uint8_t errors>
+void task(meta & meta,
+          size_t const bin,
+          int32_t const ref_id_offset,
+          std::span<alignment_info> alignment_infos,
+          std::vector<sam_entry> & records)
+{
+    std::vector<uint8_t> buffer{};
+    std::vector<uint8_t> mate_buffer{};
+
+    for (auto [query_idx, reference_number, reference_position, mate_offset, reverse_complement] : alignment_infos)
+    {
+        std::span<uint8_t const> const seq =
+            oriented_sequence(meta.queries.sequence(query_idx), reverse_complement, buffer);
+        std::string_view const seq_id = meta.queries.id(query_idx);
+        auto & ref = meta.references[bin][reference_number];
+        int32_t const ref_id = ref_id_offset + reference_number;
+
+        std::optional<aligned_query> aligned = align<errors>(ref, seq, reference_position);
+        if (!aligned.has_value())
+            continue;
+
+        if (meta.number_of_pairs == 0u)
+        {
+            records.emplace_back(to_dna4(seq),
+                                 std::string{seq_id},
+                                 strand_flag(reverse_complement),
+                                 ref_id,
+                                 aligned->ref_offset,
+                                 aligned->cigar,
+                                 //  record.base_qualities(),
+                                 aligned->map_qual,
+                                 no_mate,
+                                 aligned->edit_distance);
+            add_duplicates(meta, query_idx, records);
+            continue;
+        }
+
+        // Mate 2 is on the opposite strand.
+        size_t const mate_idx = query_idx + meta.number_of_pairs;
+        std::span<uint8_t const> const mate_seq =
+            oriented_sequence(meta.queries.sequence(mate_idx), !reverse_complement, mate_buffer);
+        std::string_view const mate_id = meta.queries.id(mate_idx);
+
+        size_t const mate_position = reference_position + mate_offset;
+        std::optional<aligned_query> mate_aligned = align<errors>(ref, mate_seq, mate_position);
+        if (!mate_aligned.has_value())
+            continue;
+
+        size_t const left = std::min(aligned->ref_offset, mate_aligned->ref_offset);
+        size_t const right = std::max(aligned->ref_offset + aligned->reference_span(),
+                                      mate_aligned->ref_offset + mate_aligned->reference_span());
+        int32_t const template_length = right - left;
+        bool const mate1_is_left = aligned->ref_offset <= mate_aligned->ref_offset;
+
+        seqan3::sam_flag const pair_flag = seqan3::sam_flag::paired | seqan3::sam_flag::proper_pair;
+        seqan3::sam_flag const mate1_flag = pair_flag | seqan3::sam_flag::first_in_pair
+                                          | strand_flag(reverse_complement)
+                                          | (reverse_complement ? seqan3::sam_flag::none
+                                                                : seqan3::sam_flag::mate_on_reverse_strand);
+        seqan3::sam_flag const mate2_flag = pair_flag | seqan3::sam_flag::second_in_pair
+                                          | strand_flag(!reverse_complement)
+                                          | (reverse_complement ? seqan3::sam_flag::mate_on_reverse_strand
+                                                                : seqan3::sam_flag::none);
+
+        records.emplace_back(to_dna4(seq),
+                             std::string{seq_id},
+                             mate1_flag,
+                             ref_id,
+                             aligned->ref_offset,
+                             aligned->cigar,
+                             aligned->map_qual,
+                             mate_t{ref_id,
+                                    static_cast<int32_t>(mate_aligned->ref_offset),
+                                    mate1_is_left ? template_length : -template_length},
+                             aligned->edit_distance);
+        records.emplace_back(to_dna4(mate_seq),
+                             std::string{mate_id},
+                             mate2_flag,
+                             ref_id,
+                             mate_aligned->ref_offset,
+                             mate_aligned->cigar,
+                             mate_aligned->map_qual,
+                             mate_t{ref_id,
+                                    static_cast<int32_t>(aligned->ref_offset),
+                                    mate1_is_left ? -template_length : template_length},
+                             mate_aligned->edit_distance);
+    }
+}
+
+// Extension of a seed chain. The query is aligned within the extension band around the diagonal of the chain.
+void extend(config const & config,
+            meta & meta,
+            size_t const bin,
+            int32_t const ref_id_offset,
+            std::span<alignment_info> alignment_infos,
+            std::vector<sam_entry> & records)
+{
+    std::vector<uint8_t> buffer{};
+
+    for (auto [query_idx, reference_number, reference_position, mate_offset, reverse_complement] : alignment_infos)
+    {
+        std::vector<seqan3::dna4> const seq =
+            to_dna4(oriented_sequence(meta.queries.sequence(query_idx), reverse_complement, buffer));
+        std::string_view const seq_id = meta.queries.id(query_idx);
+        auto & ref = meta.references[bin][reference_number];
+        int32_t const ref_id = ref_id_offset + reference_number;
+
+        size_t const length = seq.size();
+        size_t const band = extension_band(config, length);
+        size_t const start = reference_position - std::min(reference_position, band);
+        int32_t const shift = reference_position - start;
+        auto it = std::ranges::next(ref.begin(), start, ref.end());
+        auto end = std::ranges::next(it, length + 2u * band, ref.end());
+        auto ref_text = std::ranges::subrange{it, end}
+                      | std::views::transform(
+                            [](uint8_t const in) -> seqan3::dna4
+                            {
+                                return seqan3::dna4{}.assign_rank(in - 1u);
+                            });
+
+        // The query starts `shift` characters into the reference window and may deviate by `band` characters.
+        seqan3::configuration const align_config =
+            seqan3::align_cfg::method_global{seqan3::align_cfg::free_end_gaps_sequence1_leading{true},
+                                             seqan3::align_cfg::free_end_gaps_sequence2_leading{false},
+                                             seqan3::align_cfg::free_end_gaps_sequence1_trailing{true},
+                                             seqan3::align_cfg::free_end_gaps_sequence2_trailing{false}}
+            | seqan3::align_cfg::scoring_scheme{seqan3::nucleotide_scoring_scheme{seqan3::match_score{0},
+                                                                                  seqan3::mismatch_score{-1}}}
+            | seqan3::align_cfg::gap_cost_affine{seqan3::align_cfg::open_score{0},
+                                                 seqan3::align_cfg::extension_score{-1}}
+            | seqan3::align_cfg::band_fixed_size{
+                seqan3::align_cfg::lower_diagonal{shift - static_cast<int32_t>(band)},
+                seqan3::align_cfg::upper_diagonal{shift + static_cast<int32_t>(band)}}
+            | seqan3::align_cfg::output_alignment{} | seqan3::align_cfg::output_begin_position{}
+            | seqan3::align_cfg::output_score{};
+
+        for (auto && alignment : seqan3::align_pairwise(std::tie(ref_text, seq), align_config))
         {
             auto cigar = seqan3::cigar_from_alignment(alignment.alignment());
             size_t ref_offset = alignment.sequence1_begin_position() + 2 + start;
-            size_t map_qual = 60u + alignment.score();
+            // Match and gap open cost nothing, mismatch and gap extension cost 1, i.e., the score is the negative
+            // edit distance. The MAPQ falls from 60 to 0 as the edit distance grows to twice the band, which is the
+            // number of errors expected for the length of the query.
+            int32_t const edit_distance = -alignment.score();
+            size_t const max_errors = 2u * band;
+            size_t const map_qual = 60u * (max_errors - std::min<size_t>(edit_distance, max_errors)) / max_errors;
 
-            sam_out.emplace_back(seq,
-                                 seq_id,
+            records.emplace_back(seq,
+                                 std::string{seq_id},
+                                 strand_flag(reverse_complement),
                                  ref_id,
                                  ref_offset,
                                  cigar,
-                                 //  record.base_qualities(),
-                                 map_qual);
+                                 map_qual,
+                                 no_mate,
+                                 edit_distance);
+            add_duplicates(meta, query_idx, records);
         }
     }
 }
 
-void do_alignment(config const & config, meta & meta, scq::slotted_cart_queue<alignment_info> & alignment_queue)
+void do_alignment(config const & config,
+                  meta & meta,
+                  scq::slotted_cart_queue<alignment_info> & alignment_queue,
+                  std::ostream * output,
+                  bin_references * references)
 {
-    sam_out_t sam_out{config.output_path};
+    reference_dictionary dictionary = make_reference_dictionary(config, meta);
+    std::optional<sam_out_t> sam_out{};
+    if (output)
+        sam_out.emplace(*output, seqan3::format_sam{}, dictionary.ids, dictionary.lengths);
+    else
+        sam_out.emplace(config.output_path, dictionary.ids, dictionary.lengths);
+    std::mutex sam_out_mutex{};
+
+    // Each worker buffers the records of a whole cart and writes them at once. The buffer is sorted by position, such
+    // that the output consists of coordinate-sorted runs, which are cheap to merge for a downstream sort.
+    auto flush = [&](std::vector<sam_entry> & records)
+    {
+        std::ranges::sort(records,
+                          [](sam_entry const & lhs, sam_entry const & rhs)
+                          {
+                              return std::tie(lhs.ref_id, lhs.ref_offset) < std::tie(rhs.ref_id, rhs.ref_offset);
+                          });
+
+        using namespace seqan3::literals;
+        std::lock_guard lock{sam_out_mutex};
+        for (sam_entry & entry : records)
+        {
+            seqan3::sam_tag_dictionary tags{};
+            tags.get<"NM"_tag>() = entry.edit_distance;
+            sam_out->emplace_back(std::move(entry.seq),
+                                  std::move(entry.id),
+                                  entry.flag,
+                                  entry.ref_id,
+                                  entry.ref_offset,
+                                  std::move(entry.cigar),
+                                  entry.map_qual,
+                                  entry.mate,
+                                  std::move(tags));
+        }
+        records.clear();
+    };
+
+    utility::numa_topology const & topology = utility::numa_topology::system();
+    std::atomic<size_t> next_worker{};
 
-    while (true)
+#pragma omp parallel num_threads(config.threads)
     {
-        scq::cart_future<alignment_info> cart = alignment_queue.dequeue();
-        if (!cart.valid())
-            return;
-        auto [bin, alignment_infos] = cart.get();
-        task(meta, bin.value, alignment_infos, sam_out);
+        std::vector<sam_entry> records{};
+
+        // With --numa, each worker is pinned to a node and prefers the bins whose references are on this node.
+        scq::slot_range local_bins{0u, meta.number_of_bins};
+        if (config.numa)
+        {
+            size_t const node = topology.node_of_worker(next_worker++, config.threads);
+            topology.pin_to_node(node);
+            local_bins = topology.bins_of_node(node, meta.number_of_bins);
+        }
+
+        if (config.seed_length != 0u)
+        {
+            while (true)
+            {
+                scq::cart_future<alignment_info> cart = alignment_queue.dequeue(local_bins);
+                if (!cart.valid())
+                    break;
+                auto [bin, alignment_infos] = cart.get();
+                extend(config, meta, bin.value, dictionary.offsets[bin.value], alignment_infos, records);
+                flush(records);
+                if (references)
+                    references->aligned(bin.value, alignment_infos.size());
+            }
+        }
+        else
+        {
+            dispatch_errors(config.errors,
+                            [&](auto errors)
+                            {
+                                while (true)
+                                {
+                                    scq::cart_future<alignment_info> cart = alignment_queue.dequeue(local_bins);
+                                    if (!cart.valid())
+                                        return;
+                                    auto [bin, alignment_infos] = cart.get();
+                                    task<decltype(errors)::value>(meta,
+                                                                  bin.value,
+                                                                  dictionary.offsets[bin.value],
+                                                                  alignment_infos,
+                                                                  records);
+                                    flush(records);
+                                    if (references)
+                                        references->aligned(bin.value, alignment_infos.size());
+                                }
+                            });
+        }
+
+        // The threads of this team are reused by later parallel regions of the calling thread.
+        if (config.numa)
+            topology.unpin();
     }
 }
 
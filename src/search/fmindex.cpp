@@ -2,73 +2,698 @@
 // SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: BSD-3-Clause
 
-#include <cstddef> // for size_t
-#include <cstdint> // for uint8_t
-#include <ranges>  // for transform_view, __fn, transform, views
-#include <tuple>   // for get
-#include <utility> // for get
-#include <vector>  // for vector
+#include <algorithm>  // for max, min, sort
+#include <atomic>     // for atomic
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uint8_t, int64_t
+#include <exception>  // for current_exception, exception_ptr, rethrow_exception
+#include <filesystem> // for path
+#include <fstream>    // for ifstream
+#include <functional> // for equal_to, less
+#include <ios>        // for ios
+#include <memory>     // for shared_ptr, make_shared
+#include <optional>   // for optional, nullopt
+#include <ranges>     // for iota_view, transform_view, __fn, transform, views
+#include <span>       // for span
+#include <stdexcept>  // for runtime_error
+#include <string>     // for operator+, to_string
+#include <tuple>      // for get, tuple
+#include <utility>    // for get, move
+#include <vector>     // for vector
 
-#include <seqan3/alphabet/nucleotide/dna4.hpp> // for dna4
-#include <seqan3/io/sequence_file/record.hpp>  // for sequence_record
-
-// clang-format: off
-#include <fpgalign/utility/compat.hpp> // IWYU pragma: keep
-// clang-format: on
-
-#include <fmindex-collection/fmindex/BiFMIndex.h> // for BiFMIndex
-#include <fmindex-collection/search/search.h>     // for search
+#include <fmindex-collection/fmindex/BiFMIndex.h>       // for BiFMIndex
+#include <fmindex-collection/fmindex/BiFMIndexCursor.h> // for BiFMIndexCursor
 
 #include <fpgalign/config.hpp>                     // for config
-#include <fpgalign/contrib/slotted_cart_queue.hpp> // for slotted_cart_queue, cart_future, slot_id, span
+#include <fpgalign/contrib/slotted_cart_queue.hpp> // for slotted_cart_queue, cart_future, slot_id, slot_range, span
 #include <fpgalign/meta.hpp>                       // for meta
-#include <fpgalign/search/search.hpp>              // for alignment_info, fmindex
-#include <fpgalign/utility/fmindex.hpp>            // for load
+#include <fpgalign/search/search.hpp>              // for alignment_info, dispatch_errors, extension_band, fmindex
+#include <fpgalign/utility/compat.hpp>             // for fixed_errors_search
+#include <fpgalign/utility/fmindex.hpp>            // for fmindex_cache, load
+#include <fpgalign/utility/numa.hpp>               // for numa_topology
+#include <fpgalign/utility/prefetch.hpp>           // for index_prefetcher
 
 namespace search
 {
 
-void fmindex(config const & config,
-             meta & meta,
-             scq::slotted_cart_queue<size_t> & filter_queue,
-             scq::slotted_cart_queue<alignment_info> & alignment_queue)
+// The i-th character of the query in the FM-index alphabet (rank + 1). On the reverse strand, this is the complement
+// of the (length - 1 - i)-th character.
+uint8_t fm_symbol(std::span<uint8_t const> const sequence, size_t const i, bool const reverse_complement)
 {
-#pragma omp parallel num_threads(config.threads)
+    if (reverse_complement)
+        return 5u - sequence[sequence.size() - 1u - i];
+    return sequence[i];
+}
+
+// Backward search without errors. Up to `batch_size` queries are advanced in lock-step: Each round extends every
+// active query by one character. After extending a query, the occurrence blocks needed for its next extension are
+// prefetched. The prefetch then completes while the other queries of the batch are extended.
+// Both strands of a query are searched in separate lanes of the same batch.
+// A lane that is finished is replaced by the next one, such that the batch stays full.
+template <typename index_t, typename callback_t>
+void exact_search(index_t const & index,
+                  meta const & meta,
+                  std::span<size_t const> query_indices,
+                  size_t const batch_size,
+                  callback_t && callback)
+{
+    using cursor_t = fmc::BiFMIndexCursor<index_t>;
+
+    struct lane_t
+    {
+        size_t query_idx;
+        size_t remaining;
+        bool reverse_complement;
+        cursor_t cursor;
+    };
+
+    auto next_query = query_indices.begin();
+    bool next_reverse_complement{false};
+    auto next_lane = [&]() -> std::optional<lane_t>
+    {
+        for (; next_query != query_indices.end(); ++next_query)
+        {
+            if (size_t const length = meta.queries.sequence(*next_query).size(); length != 0u)
+            {
+                lane_t lane{.query_idx = *next_query,
+                            .remaining = length,
+                            .reverse_complement = next_reverse_complement,
+                            .cursor = cursor_t{index}};
+                if (next_reverse_complement)
+                    ++next_query;
+                next_reverse_complement = !next_reverse_complement;
+                return lane;
+            }
+        }
+        return std::nullopt;
+    };
+
+    std::vector<lane_t> lanes{};
+    lanes.reserve(batch_size);
+    for (std::optional<lane_t> lane = next_lane(); lane.has_value(); lane = next_lane())
+    {
+        lanes.push_back(*lane);
+        if (lanes.size() == batch_size)
+            break;
+    }
+
+    while (!lanes.empty())
+    {
+        for (size_t i = 0; i < lanes.size();)
+        {
+            lane_t & lane = lanes[i];
+            std::span<uint8_t const> const sequence = meta.queries.sequence(lane.query_idx);
+            lane.cursor = lane.cursor.extendLeft(fm_symbol(sequence, --lane.remaining, lane.reverse_complement));
+
+            if (!lane.cursor.empty() && lane.remaining != 0u)
+            {
+                lane.cursor.prefetchLeft();
+                ++i;
+                continue;
+            }
+
+            if (!lane.cursor.empty())
+                callback(lane.query_idx, lane.reverse_complement, lane.cursor);
+
+            if (std::optional<lane_t> next = next_lane(); next.has_value())
+            {
+                lane = *next;
+                ++i;
+            }
+            else
+            {
+                lane = lanes.back();
+                lanes.pop_back();
+            }
+        }
+    }
+}
+
+// Seed-and-extend for long queries. Both strands of the query are split into non-overlapping seeds of `seed_length`
+// that are searched without errors. Seeds with more than `max_seed_occurrences` occurrences are repetitive and ignored.
+// Each occurrence is an anchor on the diagonal `reference position - seed offset`. Anchors of the same strand and
+// reference whose diagonals are within the extension band are chained. For each strand and reference, the chain with
+// the most anchors is reported if it has at least half as many anchors as the best chain of the query.
+template <typename index_t, typename callback_t>
+void seed_search(index_t const & index,
+                 config const & config,
+                 meta const & meta,
+                 std::span<size_t const> query_indices,
+                 callback_t && callback)
+{
+    using cursor_t = fmc::BiFMIndexCursor<index_t>;
+    static constexpr size_t max_seed_occurrences{64u};
+
+    struct anchor_t
+    {
+        bool reverse_complement;
+        size_t reference_number;
+        int64_t diagonal;
+    };
+
+    struct chain_t
+    {
+        bool reverse_complement;
+        size_t reference_number;
+        int64_t diagonal;
+        size_t anchors;
+    };
+
+    std::vector<anchor_t> anchors{};
+    std::vector<chain_t> chains{};
+
+    for (size_t const idx : query_indices)
+    {
+        std::span<uint8_t const> const sequence = meta.queries.sequence(idx);
+        size_t const length = sequence.size();
+        int64_t const band = extension_band(config, length);
+        anchors.clear();
+        chains.clear();
+
+        for (bool const reverse_complement : {false, true})
+        {
+            for (size_t seed_begin = 0; seed_begin + config.seed_length <= length; seed_begin += config.seed_length)
+            {
+                cursor_t cursor{index};
+                for (size_t i = seed_begin + config.seed_length; i > seed_begin && !cursor.empty(); --i)
+                    cursor = cursor.extendLeft(fm_symbol(sequence, i - 1u, reverse_complement));
+
+                if (cursor.empty() || cursor.count() > max_seed_occurrences)
+                    continue;
+
+                for (auto j : cursor)
+                {
+                    auto [seqId, pos, offset] = index.locate(j);
+                    anchors.push_back(anchor_t{.reverse_complement = reverse_complement,
+                                               .reference_number = seqId,
+                                               .diagonal = static_cast<int64_t>(pos + offset)
+                                                         - static_cast<int64_t>(seed_begin)});
+                }
+            }
+        }
+
+        std::ranges::sort(anchors,
+                          std::less<>{},
+                          [](anchor_t const & anchor)
+                          {
+                              return std::tuple{anchor.reverse_complement, anchor.reference_number, anchor.diagonal};
+                          });
+
+        auto same_group = [](anchor_t const & lhs, anchor_t const & rhs)
+        {
+            return lhs.reverse_complement == rhs.reverse_complement && lhs.reference_number == rhs.reference_number;
+        };
+
+        size_t best_anchors{};
+        for (size_t group_begin = 0; group_begin < anchors.size();)
+        {
+            anchor_t const & group = anchors[group_begin];
+            chain_t best{.reverse_complement = group.reverse_complement,
+                         .reference_number = group.reference_number,
+                         .diagonal = 0,
+                         .anchors = 0u};
+
+            size_t first = group_begin;
+            size_t last = group_begin;
+            for (; last < anchors.size() && same_group(anchors[last], group); ++last)
+            {
+                while (anchors[last].diagonal - anchors[first].diagonal > band)
+                    ++first;
+
+                if (size_t const count = last - first + 1u; count > best.anchors)
+                {
+                    best.diagonal = anchors[first].diagonal;
+                    best.anchors = count;
+                }
+            }
+
+            chains.push_back(best);
+            best_anchors = std::max(best_anchors, best.anchors);
+            group_begin = last;
+        }
+
+        for (chain_t const & chain : chains)
+        {
+            if (2u * chain.anchors >= best_anchors)
+                callback(idx,
+                         chain.reverse_complement,
+                         chain.reference_number,
+                         static_cast<size_t>(std::max<int64_t>(0, chain.diagonal)));
+        }
+    }
+}
+
+// Searches the queries without errors or with `errors` many errors. Calls `on_hit(query_idx, reverse_complement,
+// reference_number, reference_position)` for each occurrence.
+template <uint8_t errors, typename index_t, typename on_hit_t>
+void approximate_search(index_t const & index,
+                        config const & config,
+                        meta const & meta,
+                        std::span<size_t const> query_indices,
+                        on_hit_t && on_hit)
+{
+    auto locate_hits = [&](size_t const idx, bool const reverse_complement, auto const & cursor)
+    {
+        for (auto j : cursor)
+        {
+            auto [seqId, pos, offset] = index.locate(j);
+            on_hit(idx, reverse_complement, seqId, pos + offset);
+        }
+    };
+
+    if constexpr (errors == 0u)
     {
-        while (true)
+        exact_search(index, meta, query_indices, config.batch_size, locate_hits);
+    }
+    else
+    {
+        for (auto idx : query_indices)
         {
-            scq::cart_future<size_t> cart = filter_queue.dequeue();
-            if (!cart.valid())
-                break;
-            auto [slot, span] = cart.get();
-            fmc::BiFMIndex<5> index{};
-            utility::load(index, config, slot.value);
-            for (auto idx : span)
+            std::span<uint8_t const> const sequence = meta.queries.sequence(idx);
+
+            for (bool const reverse_complement : {false, true})
             {
                 auto callback = [&](auto cursor, size_t)
                 {
-                    for (auto j : cursor)
-                    {
-                        auto [seqId, pos, offset] = index.locate(j);
-                        alignment_queue.enqueue(slot,
-                                                alignment_info{.query_idx = idx,
-                                                               .reference_number = seqId,
-                                                               .reference_position = pos + offset});
-                    }
+                    locate_hits(idx, reverse_complement, cursor);
                 };
 
-                auto seq_view = std::views::transform(meta.queries[idx].sequence(),
-                                                      [](seqan3::dna4 const in) -> uint8_t
+                auto seq_view = std::views::iota(size_t{}, sequence.size())
+                              | std::views::transform(
+                                    [&](size_t const i)
+                                    {
+                                        return fm_symbol(sequence, i, reverse_complement);
+                                    });
+
+                fmc::search_ng26::fixed_errors_search<errors>(index, seq_view, callback);
+            }
+        }
+    }
+}
+
+struct hit_t
+{
+    size_t query_idx;
+    bool reverse_complement;
+    size_t reference_number;
+    size_t reference_position;
+
+    friend bool operator==(hit_t const &, hit_t const &) = default;
+};
+
+// A query that is its own reverse complement is found on both strands at the same position. The hit on the reverse
+// strand is then dropped. Hits that the approximate search reports more than once are kept once, too.
+void remove_duplicate_hits(std::vector<hit_t> & hits)
+{
+    std::ranges::sort(hits,
+                      std::less<>{},
+                      [](hit_t const & hit)
+                      {
+                          return std::tuple{hit.query_idx,
+                                            hit.reference_number,
+                                            hit.reference_position,
+                                            hit.reverse_complement};
+                      });
+    auto [unique_end, hits_end] = std::ranges::unique(hits,
+                                                      std::equal_to<>{},
+                                                      [](hit_t const & hit)
                                                       {
-                                                          return in.to_rank() + 1u;
+                                                          return std::tuple{hit.query_idx,
+                                                                            hit.reference_number,
+                                                                            hit.reference_position};
                                                       });
+    hits.erase(unique_end, hits_end);
+}
+
+// Pairs the hits of both mates. Mate 1 of pair `i` is the query `i`, and mate 2 is the query `i + number_of_pairs`.
+// Two hits form a pair if they are on the same reference and on opposite strands, the hit on the forward strand is not
+// behind the hit on the reverse strand, and the insert is at most `max_insert_size` long.
+template <typename on_pair_t>
+void pair_hits(config const & config, meta const & meta, std::vector<hit_t> & hits, on_pair_t && on_pair)
+{
+    auto pair_of = [&](hit_t const & hit)
+    {
+        return hit.query_idx < meta.number_of_pairs ? hit.query_idx : hit.query_idx - meta.number_of_pairs;
+    };
+    auto group_of = [&](hit_t const & hit)
+    {
+        return std::tuple{pair_of(hit), hit.reference_number};
+    };
+
+    std::ranges::sort(hits,
+                      std::less<>{},
+                      [](hit_t const & hit)
+                      {
+                          return std::tuple{hit.query_idx,
+                                            hit.reference_number,
+                                            hit.reference_position,
+                                            hit.reverse_complement};
+                      });
+    auto [unique_end, hits_end] = std::ranges::unique(hits);
+    hits.erase(unique_end, hits_end);
+    std::ranges::stable_sort(hits, std::less<>{}, group_of);
+
+    for (size_t group_begin = 0; group_begin < hits.size();)
+    {
+        size_t group_end = group_begin;
+        while (group_end < hits.size() && group_of(hits[group_end]) == group_of(hits[group_begin]))
+            ++group_end;
+
+        for (size_t i = group_begin; i < group_end; ++i)
+        {
+            hit_t const & first = hits[i];
+            if (first.query_idx >= meta.number_of_pairs)
+                continue;
 
-                fmc::search<true>(index, seq_view, config.errors, callback);
+            for (size_t j = group_begin; j < group_end; ++j)
+            {
+                hit_t const & second = hits[j];
+                if (second.query_idx < meta.number_of_pairs || first.reverse_complement == second.reverse_complement)
+                    continue;
+
+                hit_t const & forward = first.reverse_complement ? second : first;
+                hit_t const & reverse = first.reverse_complement ? first : second;
+                size_t const reverse_end =
+                    reverse.reference_position + meta.queries.sequence(reverse.query_idx).size();
+
+                if (forward.reference_position <= reverse.reference_position
+                    && reverse_end - forward.reference_position <= config.max_insert_size)
+                    on_pair(first, second);
             }
         }
+
+        group_begin = group_end;
+    }
+}
+
+// Searches the queries (or pairs) of one cart and enqueues the hits for the alignment. Returns the number of enqueued
+// hits.
+template <uint8_t errors>
+size_t search_cart(config const & config,
+                   meta const & meta,
+                   fmc::BiFMIndex<5> const & index,
+                   scq::slot_id const slot,
+                   std::span<size_t const> span,
+                   scq::slotted_cart_queue<alignment_info> & alignment_queue,
+                   std::vector<size_t> & mate_indices,
+                   std::vector<hit_t> & hits)
+{
+    size_t enqueued{};
+
+    auto enqueue_hit = [&](size_t const idx,
+                           bool const reverse_complement,
+                           size_t const reference_number,
+                           size_t const reference_position)
+    {
+        ++enqueued;
+        alignment_queue.enqueue(slot,
+                                alignment_info{.query_idx = static_cast<uint32_t>(idx),
+                                               .reference_number = static_cast<uint32_t>(reference_number),
+                                               .reference_position = reference_position,
+                                               .mate_offset = 0,
+                                               .reverse_complement = reverse_complement});
+    };
+
+    auto collect_hit = [&](size_t const idx,
+                           bool const reverse_complement,
+                           size_t const reference_number,
+                           size_t const reference_position)
+    {
+        hits.push_back(hit_t{.query_idx = idx,
+                             .reverse_complement = reverse_complement,
+                             .reference_number = reference_number,
+                             .reference_position = reference_position});
+    };
+
+    if (config.seed_length != 0u)
+    {
+        seed_search(index, config, meta, span, enqueue_hit);
+    }
+    else if (meta.number_of_pairs == 0u)
+    {
+        hits.clear();
+        approximate_search<errors>(index, config, meta, span, collect_hit);
+        remove_duplicate_hits(hits);
+
+        for (hit_t const & hit : hits)
+            enqueue_hit(hit.query_idx, hit.reverse_complement, hit.reference_number, hit.reference_position);
+    }
+    else
+    {
+        // The cart contains pair indices. Both mates are searched, and only pairs of hits are aligned. Both strands of
+        // a palindromic mate are kept, since either of them may pair with the other mate.
+        mate_indices.clear();
+        for (size_t const pair_idx : span)
+        {
+            mate_indices.push_back(pair_idx);
+            mate_indices.push_back(pair_idx + meta.number_of_pairs);
+        }
+
+        hits.clear();
+        approximate_search<errors>(index, config, meta, mate_indices, collect_hit);
+
+        pair_hits(config,
+                  meta,
+                  hits,
+                  [&](hit_t const & mate1, hit_t const & mate2)
+                  {
+                      int64_t const mate_offset = static_cast<int64_t>(mate2.reference_position)
+                                                - static_cast<int64_t>(mate1.reference_position);
+                      ++enqueued;
+                      alignment_queue.enqueue(
+                          slot,
+                          alignment_info{.query_idx = static_cast<uint32_t>(mate1.query_idx),
+                                         .reference_number = static_cast<uint32_t>(mate1.reference_number),
+                                         .reference_position = mate1.reference_position,
+                                         .mate_offset = mate_offset,
+                                         .reverse_complement = mate1.reverse_complement});
+                  });
+    }
+
+    return enqueued;
+}
+
+template <uint8_t errors>
+void fmindex_impl(config const & config,
+                  meta & meta,
+                  scq::slotted_cart_queue<size_t> & filter_queue,
+                  scq::slotted_cart_queue<alignment_info> & alignment_queue,
+                  utility::fmindex_cache * cache)
+{
+    utility::numa_topology const & topology = utility::numa_topology::system();
+    std::atomic<size_t> next_worker{};
+    // Exceptions cannot leave the parallel region. After the first one, all workers stop.
+    std::exception_ptr error{};
+    std::atomic<bool> failed{false};
+
+#pragma omp parallel num_threads(config.threads)
+    {
+        std::vector<size_t> mate_indices{};
+        std::vector<hit_t> hits{};
+
+        // With --numa, each worker is pinned to a node and prefers the bins of this node. The indices it loads are
+        // then allocated on its node.
+        scq::slot_range local_bins{0u, meta.number_of_bins};
+        if (config.numa)
+        {
+            size_t const node = topology.node_of_worker(next_worker++, config.threads);
+            topology.pin_to_node(node);
+            local_bins = topology.bins_of_node(node, meta.number_of_bins);
+        }
+
+        // Each worker keeps its last index and prefers carts of the same bin, such that the index is reused.
+        std::shared_ptr<fmc::BiFMIndex<5> const> index{};
+        std::optional<size_t> loaded_bin{};
+
+        try
+        {
+            while (!failed)
+            {
+                scq::cart_future<size_t> cart = loaded_bin.has_value()
+                                                   ? filter_queue.dequeue(scq::slot_id{*loaded_bin}, local_bins)
+                                                   : filter_queue.dequeue(local_bins);
+                if (!cart.valid())
+                    break;
+                auto [slot, span] = cart.get();
+                if (loaded_bin != slot.value)
+                {
+                    index.reset();
+                    if (cache)
+                    {
+                        index = cache->get(config, slot.value);
+                    }
+                    else
+                    {
+                        auto loaded = std::make_shared<fmc::BiFMIndex<5>>();
+                        utility::load(*loaded, config, slot.value);
+                        index = std::move(loaded);
+                    }
+                    loaded_bin = slot.value;
+                }
+
+                search_cart<errors>(config, meta, *index, slot, span, alignment_queue, mate_indices, hits);
+            }
+        }
+        catch (...)
+        {
+#pragma omp critical
+            {
+                if (!error)
+                    error = std::current_exception();
+            }
+            failed = true;
+        }
+
+        if (config.numa)
+            topology.unpin();
     }
 
     alignment_queue.close();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+// Each index is loaded exactly once and shared by all threads. The query indices of a bin are split into carts of
+// `queue_capacity` queries. The index of the next bin is prefetched while the current bin is searched.
+// The references of a bin are loaded with its index. Once the bin is searched, its last alignment cart is handed to the
+// alignment stage, which frees the references after the last alignment of the bin.
+template <uint8_t errors>
+void fmindex_bin_major_impl(config const & config,
+                            meta & meta,
+                            std::filesystem::path const & spill_path,
+                            std::span<spill_chunk const> chunks,
+                            scq::slotted_cart_queue<alignment_info> & alignment_queue,
+                            bin_references & references)
+{
+    std::ifstream spill{spill_path, std::ios::binary};
+    fmc::BiFMIndex<5> index{};
+    std::vector<uint32_t> buffer{};
+    std::vector<size_t> query_indices{};
+    utility::index_prefetcher prefetcher{config, meta.number_of_bins};
+
+    if (!chunks.empty())
+        prefetcher.request(chunks.front().bin);
+
+    for (auto chunk = chunks.begin(); chunk != chunks.end();)
+    {
+        size_t const bin = chunk->bin;
+
+        query_indices.clear();
+        for (; chunk != chunks.end() && chunk->bin == bin; ++chunk)
+        {
+            buffer.resize(chunk->count);
+            spill.seekg(chunk->offset);
+            spill.read(reinterpret_cast<char *>(buffer.data()), chunk->count * sizeof(uint32_t));
+            if (static_cast<size_t>(spill.gcount()) != chunk->count * sizeof(uint32_t))
+                throw std::runtime_error{"Could not read the IBF results of bin " + std::to_string(bin) + " from "
+                                         + spill_path.string() + "."};
+            query_indices.insert(query_indices.end(), buffer.begin(), buffer.end());
+        }
+
+        if (chunk != chunks.end())
+            prefetcher.request(chunk->bin);
+
+        index = fmc::BiFMIndex<5>{};
+        if (config.numa)
+        {
+            // The index is shared by all threads, hence its pages are spread over all nodes.
+            utility::numa_topology::scoped_interleave const interleave{utility::numa_topology::system()};
+            utility::load(index, config, bin);
+            references.load(bin);
+        }
+        else
+        {
+            utility::load(index, config, bin);
+            references.load(bin);
+        }
+
+        size_t const number_of_carts = (query_indices.size() + config.queue_capacity - 1u) / config.queue_capacity;
+        size_t enqueued_hits{};
+        // Exceptions cannot leave the parallel region. After the first one, the remaining carts are skipped.
+        std::exception_ptr error{};
+        std::atomic<bool> failed{false};
+
+#pragma omp parallel num_threads(config.threads) reduction(+ : enqueued_hits)
+        {
+            std::vector<size_t> mate_indices{};
+            std::vector<hit_t> hits{};
+
+#pragma omp for schedule(dynamic)
+            for (size_t i = 0; i < number_of_carts; ++i)
+            {
+                if (failed)
+                    continue;
+
+                try
+                {
+                    std::span<size_t const> const span = std::span<size_t const>{query_indices}.subspan(
+                        i * config.queue_capacity,
+                        std::min(config.queue_capacity, query_indices.size() - i * config.queue_capacity));
+                    enqueued_hits += search_cart<errors>(config,
+                                                         meta,
+                                                         index,
+                                                         scq::slot_id{bin},
+                                                         span,
+                                                         alignment_queue,
+                                                         mate_indices,
+                                                         hits);
+                }
+                catch (...)
+                {
+#pragma omp critical
+                    {
+                        if (!error)
+                            error = std::current_exception();
+                    }
+                    failed = true;
+                }
+            }
+        }
+
+        if (error)
+        {
+            alignment_queue.close();
+            std::rethrow_exception(error);
+        }
+
+        alignment_queue.flush(scq::slot_id{bin});
+        references.searched(bin, enqueued_hits);
+    }
+
+    alignment_queue.close();
+}
+
+void fmindex(config const & config,
+             meta & meta,
+             scq::slotted_cart_queue<size_t> & filter_queue,
+             scq::slotted_cart_queue<alignment_info> & alignment_queue,
+             utility::fmindex_cache * cache)
+{
+    dispatch_errors(config.errors,
+                    [&](auto errors)
+                    {
+                        fmindex_impl<decltype(errors)::value>(config, meta, filter_queue, alignment_queue, cache);
+                    });
+}
+
+void fmindex(config const & config,
+             meta & meta,
+             std::filesystem::path const & spill_path,
+             std::span<spill_chunk const> chunks,
+             scq::slotted_cart_queue<alignment_info> & alignment_queue,
+             bin_references & references)
+{
+    dispatch_errors(config.errors,
+                    [&](auto errors)
+                    {
+                        fmindex_bin_major_impl<decltype(errors)::value>(config,
+                                                                         meta,
+                                                                         spill_path,
+                                                                         chunks,
+                                                                         alignment_queue,
+                                                                         references);
+                    });
 }
 
 } // namespace search
@@ -2,93 +2,355 @@
 // SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: BSD-3-Clause
 
-#include <algorithm>  // for __move, __shuffle, move, shuffle
-#include <cstddef>    // for size_t
-#include <cstdint>    // for uint64_t
-#include <filesystem> // for path
-#include <iterator>   // for back_insert_iterator, back_inserter, operator==
-#include <random>     // for mt19937_64
-#include <ranges>     // for common_view, operator|, __fn, common, views
-#include <tuple>      // for get
-#include <vector>     // for vector
-
-#include <seqan3/io/detail/misc.hpp>          // for set_format
-#include <seqan3/io/record.hpp>               // for field, fields
-#include <seqan3/io/sequence_file/record.hpp> // for sequence_record
-#include <seqan3/search/kmer_index/shape.hpp> // for shape, ungapped
-
-#include <hibf/interleaved_bloom_filter.hpp> // for interleaved_bloom_filter
+#include <algorithm>     // for __shuffle, set_intersection, shuffle, stable_sort
+#include <chrono>        // for duration, steady_clock
+#include <cmath>         // for pow
+#include <concepts>      // for same_as
+#include <cstddef>       // for size_t
+#include <cstdint>       // for uint64_t, uint8_t
+#include <filesystem>    // for path
+#include <fstream>       // for ofstream
+#include <ios>           // for ios
+#include <iostream>      // for cerr
+#include <iterator>      // for back_insert_iterator, back_inserter, operator==
+#include <mutex>         // for mutex, lock_guard
+#include <numeric>       // for iota, partial_sum
+#include <random>        // for mt19937_64
+#include <ranges>        // for common_view, operator|, __fn, common, views
+#include <span>          // for span
+#include <stdexcept>     // for runtime_error
+#include <string>        // for operator+, string
+#include <string_view>   // for string_view
+#include <unordered_map> // for unordered_map
+#include <utility>       // for move
+#include <variant>       // for visit
+#include <vector>        // for vector
+
+#include <seqan3/search/kmer_index/shape.hpp> // for shape, ungapped, bin_literal
+
+#include <hibf/hierarchical_interleaved_bloom_filter.hpp> // for hierarchical_interleaved_bloom_filter
 
 #include <fpgalign/config.hpp>                     // for config
 #include <fpgalign/contrib/minimiser_hash.hpp>     // for minimiser_hash, operator==, operator|, minimiser_hash_fn
 #include <fpgalign/contrib/slotted_cart_queue.hpp> // for slotted_cart_queue, assert, slot_id
-#include <fpgalign/meta.hpp>                       // for meta, seqfile_t, record_t
-#include <fpgalign/search/search.hpp>              // for ibf
-#include <fpgalign/utility/ibf.hpp>                // for load
+#include <fpgalign/meta.hpp>                       // for meta
+#include <fpgalign/query_store.hpp>                // for query_store
+#include <fpgalign/search/search.hpp>              // for spill_chunk, ibf, load_queries
+#include <fpgalign/utility/ibf.hpp>                // for prefilter
+#include <fpgalign/utility/sequence_input.hpp>     // for sequence_input, dna4_rank
+#include <fpgalign/utility/threshold.hpp>          // for cached_threshold, syncmer_threshold
 #include <threshold/threshold.hpp>                 // for threshold
 #include <threshold/threshold_parameters.hpp>      // for threshold_parameters
 
 namespace search
 {
 
+// Sequences are read directly into the sequence buffer of the store.
+void read_queries(std::filesystem::path const & path, query_store & queries)
+{
+    utility::sequence_input fin{path};
+
+    while (fin.next(queries.sequences))
+        queries.push_back(fin.id());
+}
+
 threshold::threshold get_thresholder(config const & config, meta const & meta)
 {
-    size_t const first_sequence_size = [&]()
+    size_t const first_sequence_size = meta.queries.size() == 0u ? 0u : meta.queries.sequence(0u).size();
+    seqan3::shape const shape = meta.shape == 0u ? seqan3::shape{seqan3::ungapped{meta.kmer_size}}
+                                                 : seqan3::shape{seqan3::bin_literal{meta.shape}};
+
+    // Long reads have too many errors for the probabilistic threshold. Instead, require half of the expected fraction
+    // of error-free k-mers.
+    if (config.seed_length != 0u)
     {
-        seqfile_t fin{config.query_path};
-        auto & record = *fin.begin();
-        return record.sequence().size();
-    }();
+        double const error_free_kmers = std::pow(1.0 - config.error_rate, shape.count());
+        return {threshold::threshold_parameters{.window_size = meta.window_size,
+                                                .shape = shape,
+                                                .query_length = first_sequence_size,
+                                                .percentage = error_free_kmers / 2.0}};
+    }
+
+    threshold::threshold_parameters const parameters{.window_size = meta.window_size,
+                                                     .shape = shape,
+                                                     .query_length = first_sequence_size,
+                                                     .errors = config.errors};
 
-    return {threshold::threshold_parameters{.window_size = meta.window_size,
-                                            .shape = seqan3::ungapped{meta.kmer_size},
-                                            .query_length = first_sequence_size,
-                                            .errors = config.errors}};
+    if (meta.syncmer_size != 0u)
+        return utility::syncmer_threshold(parameters, meta.syncmer_size);
+
+    return utility::cached_threshold(parameters, config);
 }
 
-void ibf(config const & config, meta & meta, scq::slotted_cart_queue<size_t> & filter_queue)
+// Moves the first occurrence of each sequence to the front. The other occurrences are grouped behind them.
+void collapse_duplicates(meta & meta)
 {
-    seqan::hibf::interleaved_bloom_filter ibf{};
-    utility::load(ibf, config);
+    size_t const number_of_queries = meta.queries.size();
+    std::unordered_map<std::string_view, size_t> first_occurrences{};
+    first_occurrences.reserve(number_of_queries);
+    std::vector<size_t> order{};
+    std::vector<size_t> representatives(number_of_queries);
+
+    for (size_t i = 0; i < number_of_queries; ++i)
+    {
+        std::span<uint8_t const> const sequence = meta.queries.sequence(i);
+        std::string_view const key{reinterpret_cast<char const *>(sequence.data()), sequence.size()};
+        auto [it, inserted] = first_occurrences.try_emplace(key, order.size());
+        if (inserted)
+            order.push_back(i);
+        representatives[i] = it->second;
+    }
+
+    // Counting sort of the duplicates by their first occurrence.
+    size_t const number_of_unique_queries = order.size();
+    std::vector<size_t> offsets(number_of_unique_queries + 1u);
+    offsets[0] = number_of_unique_queries;
+    for (size_t i = 0; i < number_of_queries; ++i)
+        if (order[representatives[i]] != i)
+            ++offsets[representatives[i] + 1u];
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
 
-    assert(ibf.bin_count() == meta.number_of_bins);
+    order.resize(number_of_queries);
+    std::vector<size_t> next_duplicate(offsets.begin(), offsets.end() - 1u);
+    for (size_t i = 0; i < number_of_queries; ++i)
+        if (order[representatives[i]] != i)
+            order[next_duplicate[representatives[i]]++] = i;
+
+    meta.queries = meta.queries.permuted(order);
+    meta.duplicate_offsets = std::move(offsets);
+}
+
+void load_queries(config const & config, meta & meta)
+{
+    meta.clear_queries();
 
     meta.queries = [&]()
     {
-        std::vector<record_t> result{};
-        seqfile_t fin{config.query_path};
-        std::ranges::move(fin, std::back_inserter(result));
-        // Very fast, improves parallel processing when chunks of the query belong to the same bin.
-        std::ranges::shuffle(result, std::mt19937_64{0u});
-        return result;
+        query_store result{};
+        read_queries(config.query_path, result);
+
+        if (config.query2_path.empty())
+        {
+            // Very fast, improves parallel processing when chunks of the query belong to the same bin.
+            std::vector<size_t> permutation(result.size());
+            std::iota(permutation.begin(), permutation.end(), size_t{});
+            std::ranges::shuffle(permutation, std::mt19937_64{0u});
+            return result.permuted(permutation);
+        }
+
+        meta.number_of_pairs = result.size();
+        read_queries(config.query2_path, result);
+
+        if (result.size() != 2u * meta.number_of_pairs)
+            throw std::runtime_error{"--query and --query2 must contain the same number of records."};
+
+        // Shuffle the pairs. Mate 2 stays `number_of_pairs` positions behind mate 1.
+        std::vector<size_t> permutation(meta.number_of_pairs);
+        std::iota(permutation.begin(), permutation.end(), size_t{});
+        std::ranges::shuffle(permutation, std::mt19937_64{0u});
+
+        permutation.reserve(result.size());
+        for (size_t i = 0; i < meta.number_of_pairs; ++i)
+            permutation.push_back(permutation[i] + meta.number_of_pairs);
+        return result.permuted(permutation);
     }();
 
+    if (config.collapse_duplicates)
+        collapse_duplicates(meta);
+}
+
+// Calls `sink(bin, i)` for each bin that query (or pair) i may occur in. `make_sink()` is called once per thread.
+// The queries must have been loaded by load_queries.
+template <typename filter_t, typename make_sink_t>
+void filter(config const & config, meta & meta, filter_t const & bloom_filter, make_sink_t && make_sink)
+{
+    constexpr bool is_hierarchical = std::same_as<filter_t, seqan::hibf::hierarchical_interleaved_bloom_filter>;
+
+    if constexpr (!is_hierarchical)
+        assert(bloom_filter.bin_count() == meta.number_of_bins);
+
+    // Computed once and shared by all threads.
+    threshold::threshold const thresholder = get_thresholder(config, meta);
+
+    auto const start = std::chrono::steady_clock::now();
+
 #pragma omp parallel num_threads(config.threads)
     {
-        auto agent = ibf.membership_agent();
-        threshold::threshold const thresholder = get_thresholder(config, meta);
+        auto agent = bloom_filter.membership_agent();
         auto minimiser_view = contrib::views::minimiser_hash({.kmer_size = meta.kmer_size, //
-                                                              .window_size = meta.window_size});
+                                                              .window_size = meta.window_size,
+                                                              .shape = meta.shape,
+                                                              .syncmer_size = meta.syncmer_size});
+        auto sink = make_sink();
+        // With --bins, only the bins of the shard are searched.
+        auto sink_if_in_shard = [&](size_t const bin, size_t const i)
+        {
+            if (bin >= config.bins_begin && bin < config.bins_end)
+                sink(bin, i);
+        };
 
         std::vector<uint64_t> hashes;
+        std::vector<uint64_t> mate_bins;
+        std::vector<uint64_t> pair_bins;
 
-#pragma omp for
-        for (size_t i = 0; i < meta.queries.size(); ++i)
+        auto membership_for = [&](size_t const i) -> std::vector<uint64_t> const &
         {
-            auto & [id, seq] = meta.queries[i];
-            auto view = seq | minimiser_view | std::views::common;
+            auto view = meta.queries.sequence(i) | utility::views::dna4_rank | minimiser_view | std::views::common;
             hashes.clear();
             hashes.assign(view.begin(), view.end());
 
             auto & result = agent.membership_for(hashes, thresholder.get(hashes.size()));
-            for (size_t bin : result)
+            // The hierarchical IBF reports the bins in the order they were found.
+            if constexpr (is_hierarchical)
+                agent.sort_results();
+            return result;
+        };
+
+        if (meta.number_of_pairs == 0u)
+        {
+#pragma omp for
+            for (size_t i = 0; i < meta.number_of_searched_queries(); ++i)
+            {
+                for (size_t bin : membership_for(i))
+                {
+                    sink_if_in_shard(bin, i);
+                }
+            }
+        }
+        else
+        {
+            // Only bins that contain both mates are searched.
+#pragma omp for
+            for (size_t i = 0; i < meta.number_of_pairs; ++i)
             {
-                filter_queue.enqueue(scq::slot_id{bin}, i);
+                mate_bins = membership_for(i);
+                auto & result = membership_for(i + meta.number_of_pairs);
+                pair_bins.clear();
+                std::ranges::set_intersection(mate_bins, result, std::back_inserter(pair_bins));
+
+                for (size_t bin : pair_bins)
+                {
+                    sink_if_in_shard(bin, i);
+                }
             }
         }
     }
 
+    if (config.verbose)
+    {
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+        std::cerr << (is_hierarchical ? "HIBF" : "IBF") << " search: " << meta.queries.size() << " queries in "
+                  << elapsed.count() << " s (" << meta.queries.size() / elapsed.count() << " queries/s)\n";
+    }
+}
+
+void ibf(config const & config,
+         meta & meta,
+         utility::prefilter const & bloom_filter,
+         scq::slotted_cart_queue<size_t> & filter_queue)
+{
+    std::visit(
+        [&](auto const & filter_variant)
+        {
+            filter(config,
+                   meta,
+                   filter_variant,
+                   [&]()
+                   {
+                       return [&](size_t const bin, size_t const i)
+                       {
+                           filter_queue.enqueue(scq::slot_id{bin}, i);
+                       };
+                   });
+        },
+        bloom_filter);
+
     filter_queue.close();
 }
 
+// Collects the query indices of each bin and appends them to the spill file in chunks.
+class spill_writer
+{
+public:
+    static constexpr size_t chunk_size{1024u};
+
+    spill_writer(std::ofstream & spill, std::mutex & mutex, std::vector<spill_chunk> & chunks, size_t const bins) :
+        spill{spill},
+        mutex{mutex},
+        chunks{chunks},
+        buffers(bins)
+    {}
+
+    spill_writer(spill_writer const &) = delete;
+    spill_writer & operator=(spill_writer const &) = delete;
+
+    ~spill_writer()
+    {
+        for (size_t bin = 0; bin < buffers.size(); ++bin)
+            flush(bin);
+    }
+
+    void operator()(size_t const bin, size_t const i)
+    {
+        buffers[bin].push_back(static_cast<uint32_t>(i));
+        if (buffers[bin].size() == chunk_size)
+            flush(bin);
+    }
+
+private:
+    void flush(size_t const bin)
+    {
+        std::vector<uint32_t> & buffer = buffers[bin];
+        if (buffer.empty())
+            return;
+
+        std::lock_guard lock{mutex};
+        chunks.push_back(spill_chunk{.bin = bin, .offset = static_cast<size_t>(spill.tellp()), .count = buffer.size()});
+        spill.write(reinterpret_cast<char const *>(buffer.data()), buffer.size() * sizeof(uint32_t));
+        buffer.clear();
+    }
+
+    std::ofstream & spill;
+    std::mutex & mutex;
+    std::vector<spill_chunk> & chunks;
+    std::vector<std::vector<uint32_t>> buffers;
+};
+
+std::vector<spill_chunk> ibf(config const & config,
+                             meta & meta,
+                             utility::prefilter const & bloom_filter,
+                             std::filesystem::path const & spill_path)
+{
+    std::ofstream spill{spill_path, std::ios::binary};
+    if (!spill.good())
+        throw std::runtime_error{"Could not open " + spill_path.string() + " for writing."};
+
+    std::mutex mutex{};
+    std::vector<spill_chunk> chunks{};
+
+    std::visit(
+        [&](auto const & filter_variant)
+        {
+            filter(config,
+                   meta,
+                   filter_variant,
+                   [&]()
+                   {
+                       return spill_writer{spill, mutex, chunks, meta.number_of_bins};
+                   });
+        },
+        bloom_filter);
+
+    if (!spill.good())
+        throw std::runtime_error{"Could not write " + spill_path.string() + "."};
+
+    // Phase two visits the bins in order.
+    std::ranges::stable_sort(chunks,
+                             [](spill_chunk const & lhs, spill_chunk const & rhs)
+                             {
+                                 return lhs.bin < rhs.bin;
+                             });
+    return chunks;
+}
+
 } // namespace search
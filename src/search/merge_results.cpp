@@ -0,0 +1,217 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <algorithm>     // for min, max
+#include <array>         // for array
+#include <cstddef>       // for size_t
+#include <cstdint>       // for int32_t
+#include <filesystem>    // for path
+#include <optional>      // for optional
+#include <stdexcept>     // for runtime_error
+#include <string>        // for basic_string, string, to_string
+#include <tuple>         // for get
+#include <unordered_map> // for unordered_map
+#include <utility>       // for move
+#include <vector>        // for vector
+
+#include <seqan3/contrib/stream/bgzf_stream_util.hpp> // for bgzf_thread_count
+#include <seqan3/io/record.hpp>                       // for field, fields
+#include <seqan3/io/sam_file/format_bam.hpp>          // for format_bam
+#include <seqan3/io/sam_file/format_sam.hpp>          // for format_sam
+#include <seqan3/io/sam_file/input.hpp>               // for sam_file_input
+#include <seqan3/io/sam_file/output.hpp>              // for sam_file_output
+#include <seqan3/io/sam_file/sam_flag.hpp>            // for sam_flag
+#include <seqan3/io/sam_file/sam_tag_dictionary.hpp>  // for sam_tag_dictionary, operator""_tag
+#include <seqan3/utility/type_list/type_list.hpp>     // for type_list
+
+#include <fpgalign/config.hpp>        // for config
+#include <fpgalign/search/search.hpp> // for merge_results
+
+namespace search
+{
+
+namespace
+{
+
+using merged_fields_t = seqan3::fields<seqan3::field::seq,
+                                       seqan3::field::id,
+                                       seqan3::field::flag,
+                                       seqan3::field::ref_id,
+                                       seqan3::field::ref_offset,
+                                       seqan3::field::cigar,
+                                       seqan3::field::mapq,
+                                       seqan3::field::mate,
+                                       seqan3::field::tags>;
+using merged_formats_t = seqan3::type_list<seqan3::format_sam, seqan3::format_bam>;
+using sam_in_t = seqan3::sam_file_input<seqan3::sam_file_input_default_traits<>, merged_fields_t, merged_formats_t>;
+using sam_out_t = seqan3::sam_file_output<merged_fields_t, merged_formats_t, std::vector<std::string>>;
+
+using mate_t = std::tuple<std::optional<int32_t>, std::optional<int32_t>, int32_t>;
+
+// The errors of both mates of a pair. A mate that occurs in several records is only counted once.
+struct pair_errors_t
+{
+    std::array<std::optional<int32_t>, 2> mates{};
+
+    void set(seqan3::sam_flag const flag, int32_t const errors)
+    {
+        mates[static_cast<bool>(flag & seqan3::sam_flag::first_in_pair) ? 0u : 1u] = errors;
+    }
+
+    int32_t sum() const
+    {
+        return mates[0].value_or(0) + mates[1].value_or(0);
+    }
+};
+
+// The mates of a pair may have the ID of their template with a `/1` or `/2` suffix.
+std::string template_id(std::string const & id, seqan3::sam_flag const flag)
+{
+    if (static_cast<bool>(flag & seqan3::sam_flag::paired) && id.size() >= 2u && id[id.size() - 2u] == '/'
+        && (id.back() == '1' || id.back() == '2'))
+        return id.substr(0, id.size() - 2u);
+    return id;
+}
+
+// A pair is identified by the ID of its template. The two records of a pair are on the same reference, and each stores
+// the position of the other one.
+std::string pair_key(std::string const & read_id,
+                     int32_t const ref_id,
+                     std::optional<int32_t> const position,
+                     mate_t const & mate)
+{
+    int32_t const first = position.value_or(-1);
+    int32_t const second = std::get<1>(mate).value_or(-1);
+    return read_id + '\t' + std::to_string(ref_id) + '\t' + std::to_string(std::min(first, second)) + '\t'
+         + std::to_string(std::max(first, second));
+}
+
+int32_t edit_distance(seqan3::sam_tag_dictionary & tags, std::filesystem::path const & path)
+{
+    using namespace seqan3::literals;
+    if (!tags.contains("NM"_tag))
+        throw std::runtime_error{"A record of " + path.string()
+                                 + " has no NM tag. Please search again with this version of FPGAlign."};
+    return tags.get<"NM"_tag>();
+}
+
+// The header of each shard only lists the references of its bins.
+struct merged_references
+{
+    std::vector<std::string> ids;
+    std::vector<size_t> lengths;
+    std::unordered_map<std::string, int32_t> index;
+    // mapping[i][j] is the merged ID of reference j of input i.
+    std::vector<std::vector<int32_t>> mapping;
+
+    void add(sam_in_t & input)
+    {
+        std::vector<int32_t> & input_mapping = mapping.emplace_back();
+        auto const & header = input.header();
+
+        for (size_t i = 0; i < header.ref_ids().size(); ++i)
+        {
+            std::string const & id = header.ref_ids()[i];
+            auto [it, inserted] = index.emplace(id, static_cast<int32_t>(ids.size()));
+            if (inserted)
+            {
+                ids.push_back(id);
+                lengths.push_back(std::get<0>(header.ref_id_info[i]));
+            }
+            input_mapping.push_back(it->second);
+        }
+    }
+
+    std::optional<int32_t> map(size_t const input, std::optional<int32_t> const ref_id) const
+    {
+        if (!ref_id.has_value())
+            return std::nullopt;
+        return mapping[input][*ref_id];
+    }
+};
+
+// The second pass reads the same inputs as the first one, hence all keys are known.
+template <typename map_t>
+auto const & lookup(map_t const & map, std::string const & key, std::filesystem::path const & path)
+{
+    auto const it = map.find(key);
+    if (it == map.end())
+        throw std::runtime_error{"The file " + path.string() + " was modified while merging the results."};
+    return it->second;
+}
+
+} // namespace
+
+// The best records of a read are the ones with the fewest errors, which are taken from the NM tag. The MAPQ cannot be
+// compared, since seed-and-extend scales it by the length of the read. For paired-end reads, a pair is rated by the
+// errors of both mates, and both records of the best pairs are kept.
+// The inputs are read twice: first to find the fewest errors of each read, then to write the best records.
+void merge_results(config const & config)
+{
+    seqan3::contrib::bgzf_thread_count = config.threads;
+
+    // The errors of each read, and of each pair of a paired-end read.
+    std::unordered_map<std::string, int32_t> best_errors{};
+    std::unordered_map<std::string, pair_errors_t> pair_errors{};
+    merged_references references{};
+
+    auto update_best = [&](std::string const & id, int32_t const errors)
+    {
+        int32_t & best = best_errors.try_emplace(id, errors).first->second;
+        best = std::min(best, errors);
+    };
+
+    for (size_t i = 0; i < config.result_paths.size(); ++i)
+    {
+        sam_in_t input{config.result_paths[i]};
+        references.add(input);
+
+        for (auto && [seq, id, flag, ref_id, ref_offset, cigar, mapq, mate, tags] : input)
+        {
+            int32_t const errors = edit_distance(tags, config.result_paths[i]);
+            if (static_cast<bool>(flag & seqan3::sam_flag::paired))
+            {
+                std::string const key = pair_key(template_id(id, flag), *references.map(i, ref_id), ref_offset, mate);
+                pair_errors[key].set(flag, errors);
+            }
+            else
+                update_best(id, errors);
+        }
+    }
+
+    for (auto const & [key, errors] : pair_errors)
+        update_best(key.substr(0, key.find('\t')), errors.sum());
+
+    sam_out_t output{config.output_path, references.ids, references.lengths};
+
+    for (size_t i = 0; i < config.result_paths.size(); ++i)
+    {
+        sam_in_t input{config.result_paths[i]};
+        for (auto && [seq, id, flag, ref_id, ref_offset, cigar, mapq, mate, tags] : input)
+        {
+            std::optional<int32_t> const merged_ref_id = references.map(i, ref_id);
+            std::string const read_id = template_id(id, flag);
+            std::filesystem::path const & path = config.result_paths[i];
+            int32_t const errors =
+                static_cast<bool>(flag & seqan3::sam_flag::paired)
+                    ? lookup(pair_errors, pair_key(read_id, *merged_ref_id, ref_offset, mate), path).sum()
+                    : edit_distance(tags, path);
+            if (errors != lookup(best_errors, read_id, path))
+                continue;
+
+            auto & [mate_ref_id, mate_position, template_length] = mate;
+            output.emplace_back(std::move(seq),
+                                std::move(id),
+                                flag,
+                                merged_ref_id,
+                                ref_offset,
+                                std::move(cigar),
+                                mapq,
+                                std::tuple{references.map(i, mate_ref_id), mate_position, template_length},
+                                std::move(tags));
+        }
+    }
+}
+
+} // namespace search
@@ -2,29 +2,209 @@
 // SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: BSD-3-Clause
 
-#include <cstddef> // for size_t
-#include <string>  // for basic_string
-#include <thread>  // for jthread
-#include <vector>  // for vector
+#include <algorithm>  // for max, min
+#include <cstddef>    // for size_t
+#include <exception>  // for current_exception, exception_ptr, rethrow_exception
+#include <filesystem> // for path, remove
+#include <functional> // for function
+#include <iostream>   // for cerr
+#include <mutex>      // for mutex, lock_guard
+#include <ostream>    // for ostream
+#include <stdexcept>  // for runtime_error
+#include <string>     // for basic_string, to_string
+#include <thread>     // for jthread
+#include <vector>     // for vector
 
+#include <seqan3/contrib/stream/bgzf_stream_util.hpp> // for bgzf_thread_count
+
+#include <fpgalign/colored_strings.hpp>            // for colored_strings
 #include <fpgalign/config.hpp>                     // for config
-#include <fpgalign/contrib/slotted_cart_queue.hpp> // for slotted_cart_queue
+#include <fpgalign/contrib/slotted_cart_queue.hpp> // for slotted_cart_queue, slot_range
 #include <fpgalign/meta.hpp>                       // for meta
-#include <fpgalign/search/search.hpp>              // for alignment_info, do_alignment, fmindex, ibf, search
+#include <fpgalign/search/search.hpp>              // for alignment_info, bin_references, spill_chunk, do_alignment...
+#include <fpgalign/utility/huge_pages.hpp>         // for peak_huge_page_memory
+#include <fpgalign/utility/ibf.hpp>                // for load, memory_usage, prefilter
 #include <fpgalign/utility/meta.hpp>               // for load
+#include <fpgalign/utility/numa.hpp>               // for numa_topology
+#include <fpgalign/utility/prefetch.hpp>           // for index_prefetcher
 #include <fpgalign/utility/reference.hpp>          // for load
 
 namespace search
 {
 
-void search(config const & config)
+namespace
+{
+
+// An exception must not leave the thread of a stage. The first one is kept and rethrown once all stages have finished.
+// The queues are closed, such that the other stages stop: their enqueues throw and their dequeues return no cart.
+class stage_errors
+{
+public:
+    template <typename... queue_t>
+    explicit stage_errors(queue_t &... queues) :
+        close_queues{[&queues...]()
+                     {
+                         (queues.close(), ...);
+                     }}
+    {}
+
+    template <typename stage_t>
+    void run(stage_t && stage)
+    {
+        try
+        {
+            stage();
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard lock{mutex};
+                if (!error)
+                    error = std::current_exception();
+            }
+            close_queues();
+        }
+    }
+
+    void rethrow() const
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+private:
+    std::function<void()> close_queues;
+    std::mutex mutex{};
+    std::exception_ptr error{};
+};
+
+} // namespace
+
+void bin_references::load(size_t const bin)
+{
+    utility::load(search_meta.references[bin], search_config, bin);
+}
+
+void bin_references::searched(size_t const bin, size_t const hits)
+{
+    std::lock_guard lock{mutex};
+    states[bin].searched = hits;
+    free_if_done(bin);
+}
+
+void bin_references::aligned(size_t const bin, size_t const hits)
+{
+    std::lock_guard lock{mutex};
+    states[bin].aligned += hits;
+    free_if_done(bin);
+}
+
+void bin_references::free_if_done(size_t const bin)
+{
+    if (states[bin].searched == states[bin].aligned)
+        search_meta.references[bin] = {};
+}
+
+void load_index(config const & config, meta & meta, utility::prefilter & bloom_filter)
 {
-    meta meta{};
     utility::load(meta, config);
 
+    utility::numa_topology const & topology = utility::numa_topology::system();
+    if (config.numa)
+    {
+        // The IBF is accessed by all nodes, hence its pages are spread over all of them.
+        utility::numa_topology::scoped_interleave const interleave{topology};
+        utility::load(bloom_filter, config, meta);
+    }
+    else
+    {
+        utility::load(bloom_filter, config, meta);
+    }
+
+    // With --bins, only the references of the shard are needed. In bin-major mode, the references of a bin are only
+    // loaded while the bin is searched, see bin_references.
     meta.references.resize(meta.number_of_bins);
-    for (size_t i = 0; i < meta.number_of_bins; ++i)
-        utility::load(meta.references[i], config, i);
+    auto load_references = [&](scq::slot_range const bins)
+    {
+        if (config.bin_major)
+            return;
+
+        for (size_t i = std::max(bins.begin, config.bins_begin); i < std::min(bins.end, config.bins_end); ++i)
+            utility::load(meta.references[i], config, i);
+    };
+
+    if (config.numa && topology.node_count() > 1u)
+    {
+        // The references of a bin are loaded by a thread on the node of the bin, such that they are allocated there.
+        std::vector<std::exception_ptr> errors(topology.node_count());
+        {
+            std::vector<std::jthread> loaders{};
+            for (size_t node = 0; node < topology.node_count(); ++node)
+            {
+                loaders.emplace_back(
+                    [&, node]()
+                    {
+                        try
+                        {
+                            topology.pin_to_node(node);
+                            load_references(topology.bins_of_node(node, meta.number_of_bins));
+                        }
+                        catch (...)
+                        {
+                            errors[node] = std::current_exception();
+                        }
+                    });
+            }
+        }
+
+        for (std::exception_ptr const & error : errors)
+            if (error)
+                std::rethrow_exception(error);
+    }
+    else
+    {
+        load_references(scq::slot_range{0u, meta.number_of_bins});
+    }
+
+    // alignment_info only has room for 32-bit reference numbers and 40-bit positions.
+    for (std::vector<size_t> const & lengths : meta.ref_lengths)
+    {
+        if (lengths.size() > alignment_info::max_reference_number)
+            throw std::runtime_error{"A bin contains too many references."};
+        for (size_t const length : lengths)
+            if (length > alignment_info::max_reference_position)
+                throw std::runtime_error{"A reference is too long."};
+    }
+
+    if (config.max_insert_size > alignment_info::max_mate_offset)
+        throw std::runtime_error{"--max-insert-size must be at most " + std::to_string(alignment_info::max_mate_offset)
+                                 + "."};
+}
+
+void search(config const & config,
+            meta & meta,
+            utility::prefilter const & bloom_filter,
+            std::ostream * output,
+            utility::fmindex_cache * cache)
+{
+    load_queries(config, meta);
+
+    // alignment_info only has room for 32-bit query indices. Like the limits of the index, this is checked before the
+    // stages are started.
+    if (meta.queries.size() > alignment_info::max_query_idx)
+        throw std::runtime_error{"Too many queries. Please split the query file."};
+
+    // Seed-and-extend cannot find queries that do not contain a single seed.
+    if (config.seed_length != 0u)
+    {
+        size_t short_queries{};
+        for (size_t i = 0; i < meta.number_of_searched_queries(); ++i)
+            short_queries += meta.queries.sequence(i).size() < config.seed_length;
+
+        if (short_queries != 0u)
+            std::cerr << colored_strings::cerr::warning << short_queries
+                      << " queries are shorter than --seed-length and are not searched.\n";
+    }
 
     // todo capacity
     // each slot = 1 bin
@@ -36,18 +216,94 @@ void search(config const & config)
                                                              .carts = meta.number_of_bins,
                                                              .capacity = config.queue_capacity}};
 
-    std::jthread ibf_thread(
-        [&]()
+    if (config.bin_major)
+    {
+        std::filesystem::path spill_path{config.output_path};
+        spill_path += ".spill";
+
+        std::vector<spill_chunk> const chunks = ibf(config, meta, bloom_filter, spill_path);
+        bin_references references{config, meta};
+        stage_errors errors{alignment_queue};
         {
-            ibf(config, meta, filter_queue);
-        });
-    std::jthread fmindex_thread(
-        [&]()
+            std::jthread fmindex_thread(
+                [&]()
+                {
+                    errors.run(
+                        [&]()
+                        {
+                            fmindex(config, meta, spill_path, chunks, alignment_queue, references);
+                        });
+                });
+
+            errors.run(
+                [&]()
+                {
+                    do_alignment(config, meta, alignment_queue, output, &references);
+                });
+        }
+
+        std::filesystem::remove(spill_path);
+        errors.rethrow();
+        return;
+    }
+
+    // A full cart will be searched soon, so its index is read from disk in the meantime.
+    utility::index_prefetcher prefetcher{config, meta.number_of_bins};
+    filter_queue.on_full_cart(
+        [&prefetcher](scq::slot_id const slot)
         {
-            fmindex(config, meta, filter_queue, alignment_queue);
+            prefetcher.request(slot.value);
         });
 
-    do_alignment(config, meta, alignment_queue);
+    stage_errors errors{filter_queue, alignment_queue};
+    {
+        std::jthread ibf_thread(
+            [&]()
+            {
+                errors.run(
+                    [&]()
+                    {
+                        ibf(config, meta, bloom_filter, filter_queue);
+                    });
+            });
+        std::jthread fmindex_thread(
+            [&]()
+            {
+                errors.run(
+                    [&]()
+                    {
+                        fmindex(config, meta, filter_queue, alignment_queue, cache);
+                    });
+            });
+
+        errors.run(
+            [&]()
+            {
+                do_alignment(config, meta, alignment_queue, output, nullptr);
+            });
+    }
+
+    errors.rethrow();
+}
+
+void search(config const & config)
+{
+    // BGZF-compressed queries and BAM output are (de)compressed on multiple threads.
+    seqan3::contrib::bgzf_thread_count = config.threads;
+
+    meta meta{};
+    utility::prefilter bloom_filter{};
+    load_index(config, meta, bloom_filter);
+
+    if (config.verbose)
+        std::cerr << (meta.hierarchical ? "HIBF" : "IBF") << " size: "
+                  << utility::memory_usage(bloom_filter) / (1024u * 1024u) << " MiB\n";
+
+    search(config, meta, bloom_filter, nullptr, nullptr);
+
+    if (config.huge_pages)
+        std::cerr << "Process memory backed by huge pages (AnonHugePages): up to "
+                  << utility::peak_huge_page_memory() / (1024u * 1024u) << " MiB\n";
 }
 
 } // namespace search
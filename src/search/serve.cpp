@@ -0,0 +1,263 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <array>        // for array
+#include <cerrno>       // for errno, EINTR
+#include <charconv>     // for from_chars
+#include <cstddef>      // for size_t
+#include <cstring>      // for memcpy
+#include <exception>    // for exception
+#include <filesystem>   // for path, exists, is_socket, remove
+#include <iostream>     // for cerr
+#include <ostream>      // for ostream
+#include <stdexcept>    // for runtime_error
+#include <streambuf>    // for streambuf
+#include <string>       // for basic_string, string, getline
+#include <string_view>  // for string_view
+#include <system_error> // for errc, error_code, system_category, system_error
+
+#include <sys/socket.h> // for accept, bind, listen, recv, send, socket, AF_UNIX, MSG_NOSIGNAL, SOCK_STREAM
+#include <sys/un.h>     // for sockaddr_un
+#include <unistd.h>     // for close
+
+#include <seqan3/contrib/stream/bgzf_stream_util.hpp> // for bgzf_thread_count
+
+#include <fpgalign/config.hpp>             // for config
+#include <fpgalign/meta.hpp>               // for meta
+#include <fpgalign/search/search.hpp>      // for load_index, search, serve, max_errors
+#include <fpgalign/utility/fmindex.hpp>    // for fmindex_cache
+#include <fpgalign/utility/huge_pages.hpp> // for huge_page_memory
+#include <fpgalign/utility/ibf.hpp>        // for prefilter
+
+namespace search
+{
+
+namespace
+{
+
+class file_descriptor
+{
+public:
+    explicit file_descriptor(int const fd) : fd{fd}
+    {
+        if (fd < 0)
+            throw std::system_error{errno, std::system_category()};
+    }
+
+    file_descriptor(file_descriptor const &) = delete;
+    file_descriptor & operator=(file_descriptor const &) = delete;
+
+    ~file_descriptor()
+    {
+        ::close(fd);
+    }
+
+    int get() const
+    {
+        return fd;
+    }
+
+private:
+    int fd;
+};
+
+// Buffered writes to a socket. Writes fail silently once the client has disconnected.
+class socket_streambuf : public std::streambuf
+{
+public:
+    explicit socket_streambuf(int const fd) : fd{fd}
+    {
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+    ~socket_streambuf() override
+    {
+        sync();
+    }
+
+protected:
+    int_type overflow(int_type const c) override
+    {
+        if (sync() != 0)
+            return traits_type::eof();
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        char const * data = pbase();
+        size_t remaining = pptr() - pbase();
+        while (remaining > 0u && !failed)
+        {
+            ssize_t const sent = ::send(fd, data, remaining, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR)
+                continue;
+            failed = sent < 0;
+            if (sent > 0)
+            {
+                data += sent;
+                remaining -= sent;
+            }
+        }
+        setp(buffer.data(), buffer.data() + buffer.size());
+        return failed ? -1 : 0;
+    }
+
+private:
+    int fd;
+    bool failed{false};
+    std::array<char, 1u << 16> buffer{};
+};
+
+// Reads a line without buffering ahead, so the connection can be handed to the output afterwards.
+bool read_line(int const fd, std::string & line)
+{
+    line.clear();
+    char c{};
+    while (true)
+    {
+        ssize_t const received = ::recv(fd, &c, 1u, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return !line.empty();
+        if (c == '\n')
+            return true;
+        line.push_back(c);
+    }
+}
+
+template <typename number_t>
+number_t parse_number(std::string_view const key, std::string_view const value, number_t const max)
+{
+    number_t number{};
+    auto const [end, error] = std::from_chars(value.data(), value.data() + value.size(), number);
+    if (error != std::errc{} || end != value.data() + value.size() || number > max)
+        throw std::runtime_error{"Invalid " + std::string{key} + ": " + std::string{value}};
+    return number;
+}
+
+// A job consists of `key value` lines and ends with an empty line or the end of the input:
+//   query <path>
+//   query2 <path>               (optional, paired-end)
+//   errors <n>                  (optional, defaults to --errors)
+//   collapse-duplicates <0|1>   (optional, defaults to --collapse-duplicates)
+//   seed-length <n>             (optional, defaults to --seed-length)
+config read_job(int const fd, config const & defaults)
+{
+    config job{defaults};
+    std::string line{};
+
+    while (read_line(fd, line) && !line.empty())
+    {
+        size_t const separator = line.find(' ');
+        std::string_view const key = std::string_view{line}.substr(0, separator);
+        std::string_view const value =
+            separator == std::string::npos ? std::string_view{} : std::string_view{line}.substr(separator + 1u);
+
+        if (key == "query")
+            job.query_path = value;
+        else if (key == "query2")
+            job.query2_path = value;
+        else if (key == "errors")
+            job.errors = parse_number<unsigned>(key, value, max_errors);
+        else if (key == "collapse-duplicates")
+            job.collapse_duplicates = parse_number<unsigned>(key, value, 1u) != 0u;
+        else if (key == "seed-length")
+            job.seed_length = parse_number<unsigned>(key, value, 64u);
+        else
+            throw std::runtime_error{"Unknown job option: " + std::string{key}};
+    }
+
+    if (job.query_path.empty())
+        throw std::runtime_error{"The job does not specify a query."};
+    if (!std::filesystem::exists(job.query_path))
+        throw std::runtime_error{"The query " + job.query_path.string() + " does not exist."};
+    if (!job.query2_path.empty() && !std::filesystem::exists(job.query2_path))
+        throw std::runtime_error{"The query " + job.query2_path.string() + " does not exist."};
+
+    // The same restrictions as for `FPGAlign search`.
+    if (job.seed_length != 0u && job.seed_length < 8u)
+        throw std::runtime_error{"The seed length must be in [8, 64]."};
+    if (job.seed_length != 0u && !job.query2_path.empty())
+        throw std::runtime_error{"Seed-and-extend does not support paired-end queries."};
+    if (job.collapse_duplicates && !job.query2_path.empty())
+        throw std::runtime_error{"Collapsing duplicates is not supported for paired-end queries."};
+
+    return job;
+}
+
+} // namespace
+
+// Jobs are answered one after another, each using all threads. The IBF, the references, and the thread pools stay
+// alive between jobs. The `--cached-indices` most recently used FM-Indices stay loaded, too. Since all references stay
+// loaded, there is no bin-major mode.
+void serve(config const & config)
+{
+    seqan3::contrib::bgzf_thread_count = config.threads;
+
+    meta meta{};
+    utility::prefilter bloom_filter{};
+    load_index(config, meta, bloom_filter);
+    utility::fmindex_cache cache{config.cached_indices};
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::string const socket_path = config.socket_path.string();
+    if (socket_path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error{"The socket path " + socket_path + " is too long."};
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1u);
+
+    // A socket left behind by a previous server would make bind fail. Any other file is kept.
+    if (std::filesystem::is_socket(config.socket_path))
+        std::filesystem::remove(config.socket_path);
+    else if (std::filesystem::exists(config.socket_path))
+        throw std::runtime_error{"Cannot listen on " + socket_path + ": the file exists and is not a socket."};
+
+    file_descriptor const server{::socket(AF_UNIX, SOCK_STREAM, 0)};
+    if (::bind(server.get(), reinterpret_cast<sockaddr const *>(&address), sizeof(address)) != 0
+        || ::listen(server.get(), SOMAXCONN) != 0)
+        throw std::system_error{errno, std::system_category(), "Cannot listen on " + socket_path};
+
+    if (config.huge_pages)
+        std::cerr << "Process memory backed by huge pages (AnonHugePages): "
+                  << utility::huge_page_memory() / (1024u * 1024u) << " MiB\n";
+    std::cerr << "Listening on " << socket_path << '\n';
+
+    while (true)
+    {
+        int const client_fd = ::accept(server.get(), nullptr, nullptr);
+        if (client_fd < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error{errno, std::system_category(), "Cannot accept connections"};
+        }
+        file_descriptor const client{client_fd};
+
+        socket_streambuf buffer{client.get()};
+        std::ostream output{&buffer};
+
+        try
+        {
+            ::config const job = read_job(client.get(), config);
+            search(job, meta, bloom_filter, &output, &cache);
+        }
+        catch (std::exception const & exception)
+        {
+            output << "ERROR " << exception.what() << '\n';
+        }
+
+        output.flush();
+        // The queries of a job are not needed anymore.
+        meta.clear_queries();
+    }
+}
+
+} // namespace search
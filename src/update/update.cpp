@@ -0,0 +1,158 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uint8_t, uint64_t
+#include <filesystem> // for path, file_time_type, last_write_time, rename
+#include <memory>     // for shared_ptr
+#include <optional>   // for optional
+#include <stdexcept>  // for runtime_error
+#include <string>     // for basic_string, string, to_string
+#include <utility>    // for move
+#include <vector>     // for vector
+
+#include <seqan3/contrib/stream/bgzf_stream_util.hpp> // for bgzf_thread_count
+
+#include <hibf/interleaved_bloom_filter.hpp> // for interleaved_bloom_filter, bin_index, bin_count
+#include <hibf/misc/insert_iterator.hpp>     // for insert_iterator
+
+#include <cereal/types/string.hpp> // IWYU pragma: keep
+#include <cereal/types/vector.hpp> // IWYU pragma: keep
+
+#include <fpgalign/build/build.hpp>       // for fmindex, insert_minimisers, parse_input
+#include <fpgalign/config.hpp>            // for config
+#include <fpgalign/meta.hpp>              // for meta
+#include <fpgalign/update/update.hpp>     // for changed_bins, update
+#include <fpgalign/utility/container.hpp> // for container_reader, container_writer, open_container, section_kind
+#include <fpgalign/utility/ibf.hpp>       // for load, store
+#include <fpgalign/utility/meta.hpp>      // for load, store
+
+namespace update
+{
+
+std::vector<size_t> changed_bins(meta const & meta,
+                                 std::vector<std::vector<std::string>> const & bin_paths,
+                                 std::filesystem::file_time_type const index_time)
+{
+    std::vector<size_t> result{};
+
+    for (size_t i = 0; i < bin_paths.size(); ++i)
+    {
+        bool changed = i >= meta.bin_paths.size() || bin_paths[i] != meta.bin_paths[i];
+        for (auto const & path : bin_paths[i])
+            changed = changed || std::filesystem::last_write_time(path) > index_time;
+
+        if (changed)
+            result.push_back(i);
+    }
+
+    return result;
+}
+
+// Only the FM-Indices and references of changed bins are rebuilt, and only their IBF bins are cleared and refilled.
+// New bins use the spare bins of the IBF, which is only enlarged once those run out. The size of the IBF bins is kept;
+// if a new bin has many more minimisers than the largest bin of the initial build, its false positive rate is higher.
+void update(config const & config)
+{
+    // BGZF-compressed references are decompressed on multiple threads.
+    seqan3::contrib::bgzf_thread_count = config.threads;
+
+    // The index is read from and written to the same prefix.
+    ::config index_config{config};
+    index_config.input_path = config.output_path;
+
+    meta meta{};
+    utility::load(meta, index_config);
+
+    if (meta.hierarchical)
+        throw std::runtime_error{"An index with a hierarchical IBF cannot be updated. Please rebuild it."};
+
+    std::vector<std::vector<std::string>> bin_paths = build::parse_input(config);
+    if (bin_paths.size() < meta.number_of_bins)
+        throw std::runtime_error{"The input contains " + std::to_string(bin_paths.size()) + " bins, but the index has "
+                                 + std::to_string(meta.number_of_bins) + ". Bins cannot be removed."};
+
+    std::shared_ptr<utility::container_reader const> const old_container =
+        utility::open_container(index_config.input_path);
+    std::filesystem::path index_file{config.output_path};
+    index_file += ".meta";
+    if (old_container)
+        index_file = old_container->file_path();
+
+    std::vector<size_t> const bins = changed_bins(meta, bin_paths, std::filesystem::last_write_time(index_file));
+    if (bins.empty())
+        return;
+
+    meta.bin_paths = std::move(bin_paths);
+    meta.number_of_bins = meta.bin_paths.size();
+    meta.ref_ids.resize(meta.number_of_bins);
+    meta.ref_lengths.resize(meta.number_of_bins);
+
+    std::vector<bool> is_changed(meta.number_of_bins);
+    for (size_t const bin : bins)
+        is_changed[bin] = true;
+
+    seqan::hibf::interleaved_bloom_filter ibf{};
+    utility::load(ibf, index_config);
+    if (ibf.bin_count() < meta.number_of_bins)
+        ibf.increase_bin_number_to(seqan::hibf::bin_count{meta.number_of_bins});
+
+    // A container cannot be changed in place. Unchanged sections are copied into a new one.
+    std::filesystem::path temporary_path{};
+    std::optional<utility::container_writer> container{};
+    if (old_container)
+    {
+        temporary_path = old_container->file_path();
+        temporary_path += ".tmp";
+        container.emplace(temporary_path);
+    }
+    utility::container_writer * const container_ptr = container.has_value() ? &*container : nullptr;
+
+#pragma omp parallel num_threads(config.threads)
+    {
+        std::vector<std::vector<uint8_t>> reference;
+        std::vector<uint64_t> minimisers;
+
+#pragma omp for schedule(dynamic)
+        for (size_t i = 0; i < meta.number_of_bins; ++i)
+        {
+            if (!is_changed[i])
+            {
+                if (container_ptr)
+                {
+                    container_ptr->copy(*old_container, utility::section_kind::fmindex, i);
+                    container_ptr->copy(*old_container, utility::section_kind::reference, i);
+                }
+                continue;
+            }
+
+            build::fmindex(config, meta, i, reference, container_ptr);
+
+            minimisers.clear();
+            build::insert_minimisers(meta, i, seqan::hibf::insert_iterator{minimisers});
+
+#pragma omp critical
+            {
+                ibf.clear(seqan::hibf::bin_index{i});
+                for (uint64_t const hash : minimisers)
+                    ibf.emplace(hash, seqan::hibf::bin_index{i});
+            }
+        }
+    }
+
+    if (container_ptr)
+    {
+        container_ptr->store(utility::section_kind::ibf, 0u, ibf);
+        container_ptr->store(utility::section_kind::meta, 0u, meta);
+        container_ptr->finish();
+        std::filesystem::rename(temporary_path, old_container->file_path());
+    }
+    else
+    {
+        utility::store(ibf, config);
+        utility::store(meta, config);
+    }
+}
+
+} // namespace update
@@ -0,0 +1,336 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <sys/stat.h> // for stat
+
+#include <algorithm>   // for lower_bound, min, sort
+#include <array>       // for array
+#include <bit>         // for rotl
+#include <cstddef>     // for size_t
+#include <cstdint>     // for int64_t, uint64_t
+#include <cstring>     // for memcpy
+#include <filesystem>  // for path
+#include <fstream>     // for ifstream, ofstream
+#include <ios>         // for ios, streamsize
+#include <map>         // for map
+#include <memory>      // for shared_ptr, make_shared
+#include <mutex>       // for mutex, scoped_lock
+#include <span>        // for span
+#include <stdexcept>   // for runtime_error
+#include <string>      // for string, to_string
+#include <string_view> // for string_view
+#include <tuple>       // for tie
+#include <utility>     // for move
+#include <vector>      // for vector
+
+#include <fpgalign/utility/container.hpp> // for container_reader, container_writer, checksum
+
+namespace utility
+{
+
+namespace
+{
+
+constexpr uint64_t checksum_multiplier_1{0x87C37B91114253D5ULL};
+constexpr uint64_t checksum_multiplier_2{0x4CF5AD432745937FULL};
+
+uint64_t mix(uint64_t const state, uint64_t const word)
+{
+    return std::rotl(state ^ (word * checksum_multiplier_1), 27) * checksum_multiplier_2 + 0x52DCE729u;
+}
+
+constexpr auto by_kind_and_bin = [](container_section const & lhs, container_section const & rhs)
+{
+    return std::tie(lhs.kind, lhs.bin) < std::tie(rhs.kind, rhs.bin);
+};
+
+uint64_t checksum_of(std::span<container_section const> const sections)
+{
+    checksum sum{};
+    sum.update({reinterpret_cast<char const *>(sections.data()), sections.size_bytes()});
+    return sum.value();
+}
+
+} // namespace
+
+void checksum::update(std::span<char const> bytes)
+{
+    size_t const used = length % 8u;
+    length += bytes.size();
+
+    if (used != 0u)
+    {
+        size_t const count = std::min<size_t>(8u - used, bytes.size());
+        std::memcpy(pending.data() + used, bytes.data(), count);
+        bytes = bytes.subspan(count);
+        if (used + count < 8u)
+            return;
+
+        uint64_t word{};
+        std::memcpy(&word, pending.data(), 8u);
+        state = mix(state, word);
+    }
+
+    for (; bytes.size() >= 8u; bytes = bytes.subspan(8u))
+    {
+        uint64_t word{};
+        std::memcpy(&word, bytes.data(), 8u);
+        state = mix(state, word);
+    }
+
+    std::memcpy(pending.data(), bytes.data(), bytes.size());
+}
+
+uint64_t checksum::value() const
+{
+    uint64_t word{};
+    std::memcpy(&word, pending.data(), length % 8u);
+    uint64_t result = mix(state, word) ^ length;
+
+    // Finaliser of MurmurHash3.
+    result ^= result >> 33;
+    result *= 0xFF51AFD7ED558CCDULL;
+    result ^= result >> 33;
+    result *= 0xC4CEB9FE1A85EC53ULL;
+    result ^= result >> 33;
+    return result;
+}
+
+std::streamsize checksum_ostreambuf::xsputn(char const * data, std::streamsize count)
+{
+    std::streamsize const result = target.sputn(data, count);
+    sum.update({data, static_cast<size_t>(result)});
+    written += result;
+    return result;
+}
+
+checksum_ostreambuf::int_type checksum_ostreambuf::overflow(int_type c)
+{
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        return traits_type::not_eof(c);
+
+    char const character = traits_type::to_char_type(c);
+    return xsputn(&character, 1) == 1 ? c : traits_type::eof();
+}
+
+std::streamsize checksum_istreambuf::xsgetn(char * data, std::streamsize count)
+{
+    count = std::min<uint64_t>(count, limit - read);
+    std::streamsize const result = target.sgetn(data, count);
+    sum.update({data, static_cast<size_t>(result)});
+    read += result;
+    return result;
+}
+
+checksum_istreambuf::int_type checksum_istreambuf::underflow()
+{
+    if (read == limit)
+        return traits_type::eof();
+    return target.sgetc();
+}
+
+checksum_istreambuf::int_type checksum_istreambuf::uflow()
+{
+    if (read == limit)
+        return traits_type::eof();
+
+    int_type const c = target.sbumpc();
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        char const character = traits_type::to_char_type(c);
+        sum.update({&character, 1u});
+        ++read;
+    }
+    return c;
+}
+
+std::string_view to_string(section_kind const kind)
+{
+    switch (kind)
+    {
+    case section_kind::meta:
+        return "meta";
+    case section_kind::ibf:
+        return "ibf";
+    case section_kind::fmindex:
+        return "fmindex";
+    case section_kind::reference:
+        return "reference";
+    case section_kind::hibf:
+        return "hibf";
+    }
+    return "unknown";
+}
+
+std::filesystem::path container_path(std::filesystem::path const & prefix)
+{
+    std::filesystem::path path{prefix};
+    path += ".fpgalign";
+    return path;
+}
+
+container_writer::container_writer(std::filesystem::path const & path) :
+    path{path},
+    file{path, std::ios::binary | std::ios::trunc}
+{
+    if (!file.good())
+        throw std::runtime_error{"Could not open " + path.string() + " for writing."};
+
+    // The header is written by finish.
+    container_header const placeholder{};
+    file.write(reinterpret_cast<char const *>(&placeholder), sizeof(placeholder));
+}
+
+void container_writer::begin_section(section_kind const kind, size_t const bin)
+{
+    uint64_t const position = file.tellp();
+    uint64_t const offset = (position + container_alignment - 1u) / container_alignment * container_alignment;
+    std::vector<char> const padding(offset - position);
+    file.write(padding.data(), padding.size());
+
+    sections.push_back({.kind = kind, .bin = bin, .offset = offset});
+}
+
+void container_writer::end_section(checksum_ostreambuf const & buffer)
+{
+    sections.back().size = buffer.size();
+    sections.back().checksum = buffer.value();
+
+    if (!file.good())
+        throw std::runtime_error{"Could not write " + std::string{to_string(sections.back().kind)} + " of bin "
+                                 + std::to_string(sections.back().bin) + " to " + path.string() + "."};
+}
+
+void container_writer::copy(container_reader const & source, section_kind const kind, size_t const bin)
+{
+    container_section const & entry = source.section(kind, bin);
+    std::ifstream input{source.file_path(), std::ios::binary};
+    input.seekg(entry.offset);
+
+    std::scoped_lock lock{mutex};
+    begin_section(kind, bin);
+
+    std::vector<char> buffer(1ULL << 20);
+    for (uint64_t remaining = entry.size; remaining != 0u && input.good();)
+    {
+        size_t const count = std::min<uint64_t>(remaining, buffer.size());
+        input.read(buffer.data(), count);
+        file.write(buffer.data(), input.gcount());
+        remaining -= input.gcount();
+    }
+
+    if (!input.good())
+        throw std::runtime_error{"Could not read the " + std::string{to_string(kind)} + " of bin "
+                                 + std::to_string(bin) + " from " + source.file_path().string() + "."};
+
+    // The checksum is copied as well. It is verified when the section is loaded.
+    sections.back().size = entry.size;
+    sections.back().checksum = entry.checksum;
+}
+
+void container_writer::finish()
+{
+    std::scoped_lock lock{mutex};
+
+    std::sort(sections.begin(), sections.end(), by_kind_and_bin);
+
+    container_header const header{.magic = container_magic,
+                                  .version = container_version,
+                                  .section_count = static_cast<uint32_t>(sections.size()),
+                                  .toc_offset = static_cast<uint64_t>(file.tellp()),
+                                  .toc_checksum = checksum_of(sections)};
+
+    file.write(reinterpret_cast<char const *>(sections.data()), sections.size() * sizeof(container_section));
+    file.seekp(0);
+    file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    file.close();
+
+    if (!file.good())
+        throw std::runtime_error{"Could not write " + path.string() + "."};
+}
+
+container_reader::container_reader(std::filesystem::path path) : path{std::move(path)}
+{
+    std::ifstream file{this->path, std::ios::binary};
+    container_header header{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+    if (!file.good() || header.magic != container_magic)
+        throw std::runtime_error{this->path.string() + " is not an FPGAlign index."};
+    if (header.version != container_version)
+        throw std::runtime_error{this->path.string() + " has version " + std::to_string(header.version)
+                                 + ", but version " + std::to_string(container_version)
+                                 + " is required. Please rebuild the index with this version of FPGAlign."};
+
+    sections.resize(header.section_count);
+    file.seekg(header.toc_offset);
+    file.read(reinterpret_cast<char *>(sections.data()), sections.size() * sizeof(container_section));
+
+    if (!file.good() || checksum_of(sections) != header.toc_checksum)
+        throw std::runtime_error{"The table of contents of " + this->path.string() + " is corrupt."};
+}
+
+bool container_reader::contains(section_kind const kind, size_t const bin) const
+{
+    container_section const key{.kind = kind, .bin = bin};
+    auto const it = std::lower_bound(sections.begin(), sections.end(), key, by_kind_and_bin);
+    return it != sections.end() && it->kind == kind && it->bin == bin;
+}
+
+container_section const & container_reader::section(section_kind const kind, size_t const bin) const
+{
+    container_section const key{.kind = kind, .bin = bin};
+    auto const it = std::lower_bound(sections.begin(), sections.end(), key, by_kind_and_bin);
+
+    if (it == sections.end() || it->kind != kind || it->bin != bin)
+        throw std::runtime_error{path.string() + " does not contain the " + std::string{to_string(kind)}
+                                 + " of bin " + std::to_string(bin) + "."};
+
+    return *it;
+}
+
+void container_reader::verify(container_section const & entry, checksum_istreambuf const & buffer) const
+{
+    if (buffer.size() != entry.size || buffer.value() != entry.checksum)
+        throw std::runtime_error{"The " + std::string{to_string(entry.kind)} + " of bin " + std::to_string(entry.bin)
+                                 + " in " + path.string() + " is corrupt."};
+}
+
+std::shared_ptr<container_reader const> open_container(std::filesystem::path const & prefix)
+{
+    // A container that is replaced, e.g., by `update` or `build --single-file`, has another inode or mtime.
+    struct cached_reader
+    {
+        std::array<int64_t, 5> identity{};
+        std::shared_ptr<container_reader const> reader{};
+    };
+
+    static std::mutex mutex{};
+    static std::map<std::filesystem::path, cached_reader> readers{};
+
+    std::filesystem::path path = container_path(prefix);
+    std::scoped_lock lock{mutex};
+
+    struct stat status{};
+    if (::stat(path.c_str(), &status) != 0)
+    {
+        readers.erase(path);
+        return nullptr;
+    }
+
+    std::array<int64_t, 5> const identity{static_cast<int64_t>(status.st_dev),
+                                          static_cast<int64_t>(status.st_ino),
+                                          static_cast<int64_t>(status.st_size),
+                                          static_cast<int64_t>(status.st_mtim.tv_sec),
+                                          static_cast<int64_t>(status.st_mtim.tv_nsec)};
+
+    if (auto it = readers.find(path); it != readers.end() && it->second.identity == identity)
+        return it->second.reader;
+
+    auto reader = std::make_shared<container_reader const>(path);
+    readers.insert_or_assign(std::move(path), cached_reader{identity, reader});
+    return reader;
+}
+
+} // namespace utility
@@ -2,33 +2,100 @@
 // SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include <algorithm>  // for find
 #include <cstring>    // for memcmp, size_t
 #include <filesystem> // for path
 #include <fstream>    // for basic_ifstream, basic_ofstream, basic_ios, ios, ifstream, ofstream
+#include <memory>     // for shared_ptr, make_shared
+#include <mutex>      // for lock_guard
+#include <utility>    // for move
+#include <vector>     // for vector
 
 #include <fmt/format.h> // for format
 
 #include <cereal/archives/binary.hpp> // for BinaryInputArchive, BinaryOutputArchive
 
-#include <fmindex/BiFMIndex.h>          // for BiFMIndex
-#include <fpgalign/config.hpp>          // for config
-#include <fpgalign/utility/fmindex.hpp> // for load, store
+#include <fmindex/BiFMIndex.h>             // for BiFMIndex
+#include <fpgalign/config.hpp>             // for config
+#include <fpgalign/utility/container.hpp>  // for open_container, section_kind
+#include <fpgalign/utility/fmindex.hpp>    // for fmindex_cache, load, store
+#include <fpgalign/utility/huge_pages.hpp> // for huge_page_size, large_mappings, mapping, use_huge_pages_for_new...
 
 namespace utility
 {
 
+std::filesystem::path fmindex_path(std::filesystem::path const & path, size_t const id)
+{
+    return fmt::format("{}.{}.fmindex", path.c_str(), id);
+}
+
 void store(fmc::BiFMIndex<5> const & index, config const & config, size_t const id)
 {
-    std::ofstream os{fmt::format("{}.{}.fmindex", config.output_path.c_str(), id), std::ios::binary};
+    std::ofstream os{fmindex_path(config.output_path, id), std::ios::binary};
     cereal::BinaryOutputArchive oarchive{os};
     oarchive(index);
 }
 
 void load(fmc::BiFMIndex<5> & index, config const & config, size_t const id)
 {
-    std::ifstream is{fmt::format("{}.{}.fmindex", config.input_path.c_str(), id), std::ios::binary};
-    cereal::BinaryInputArchive iarchive{is};
-    iarchive(index);
+    // The tables of the index are allocated inside fmindex-collection. Large allocations get their own mappings.
+    size_t const min_mapping_size{8u * huge_page_size};
+    std::vector<mapping> const mappings_before = config.huge_pages ? large_mappings(min_mapping_size)
+                                                                   : std::vector<mapping>{};
+
+    if (std::shared_ptr<container_reader const> container = open_container(config.input_path))
+    {
+        container->load(section_kind::fmindex, id, index);
+    }
+    else
+    {
+        std::ifstream is{fmindex_path(config.input_path, id), std::ios::binary};
+        cereal::BinaryInputArchive iarchive{is};
+        iarchive(index);
+    }
+
+    if (config.huge_pages)
+        use_huge_pages_for_new_mappings(mappings_before, min_mapping_size);
+}
+
+std::shared_ptr<fmc::BiFMIndex<5> const> fmindex_cache::get(config const & config, size_t const id)
+{
+    auto find = [&]()
+    {
+        return std::ranges::find(entries, id, &entry_t::first);
+    };
+
+    {
+        std::lock_guard lock{mutex};
+        if (auto it = find(); it != entries.end())
+        {
+            entries.splice(entries.begin(), entries, it);
+            return it->second;
+        }
+    }
+
+    // Loading takes long and is not done while holding the lock. Two threads may hence load the same index.
+    auto index = std::make_shared<fmc::BiFMIndex<5>>();
+    load(*index, config, id);
+
+    // Destroyed after the lock is released.
+    std::shared_ptr<fmc::BiFMIndex<5> const> evicted{};
+    std::lock_guard lock{mutex};
+
+    if (auto it = find(); it != entries.end())
+    {
+        entries.splice(entries.begin(), entries, it);
+        return it->second;
+    }
+
+    entries.emplace_front(id, index);
+    if (entries.size() > capacity)
+    {
+        evicted = std::move(entries.back().second);
+        entries.pop_back();
+    }
+
+    return index;
 }
 
 } // namespace utility
@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <sys/mman.h> // for madvise, MADV_HUGEPAGE
+
+#include <algorithm> // for binary_search
+#include <atomic>    // for atomic
+#include <cstddef>   // for size_t
+#include <cstdint>   // for uintptr_t
+#include <fstream>   // for ifstream
+#include <sstream>   // for istringstream
+#include <string>    // for basic_string, string, getline
+#include <vector>    // for vector
+
+#include <fpgalign/utility/huge_pages.hpp> // for huge_page_size, use_huge_pages, huge_page_memory, pe...
+
+// Older C libraries do not know MADV_COLLAPSE. Kernels before 6.1 reject it with EINVAL.
+#ifndef MADV_COLLAPSE
+#    define MADV_COLLAPSE 25
+#endif
+
+namespace utility
+{
+
+namespace
+{
+
+std::atomic<size_t> peak{};
+
+// Huge pages are only an optimisation, hence failures are ignored.
+void advise(uintptr_t const data, size_t const size)
+{
+    uintptr_t const begin = (data + huge_page_size - 1u) & ~(huge_page_size - 1u);
+    uintptr_t const end = (data + size) & ~(huge_page_size - 1u);
+    if (begin >= end)
+        return;
+
+    void * const address = reinterpret_cast<void *>(begin);
+    if (::madvise(address, end - begin, MADV_HUGEPAGE) == 0)
+        ::madvise(address, end - begin, MADV_COLLAPSE);
+}
+
+void update_peak()
+{
+    size_t const current = huge_page_memory();
+    size_t previous = peak.load();
+    while (previous < current && !peak.compare_exchange_weak(previous, current))
+    {}
+}
+
+} // namespace
+
+void use_huge_pages(void const * data, size_t const size)
+{
+    advise(reinterpret_cast<uintptr_t>(data), size);
+    update_peak();
+}
+
+std::vector<mapping> large_mappings(size_t const min_size)
+{
+    std::vector<mapping> result{};
+    std::ifstream maps{"/proc/self/maps"};
+    std::string line{};
+
+    // `begin-end perms offset dev inode [path]`. Anonymous mappings have inode 0 and no path, or `[heap]`.
+    while (std::getline(maps, line))
+    {
+        std::istringstream fields{line};
+        uintptr_t begin{};
+        uintptr_t end{};
+        char separator{};
+        std::string permissions{};
+        std::string offset{};
+        std::string device{};
+        size_t inode{};
+        std::string path{};
+        fields >> std::hex >> begin >> separator >> end >> permissions >> offset >> device >> std::dec >> inode;
+        fields >> path;
+
+        bool const anonymous = inode == 0u && (path.empty() || path == "[heap]");
+        if (anonymous && permissions.starts_with("rw") && end - begin >= min_size)
+            result.push_back(mapping{.begin = begin, .end = end});
+    }
+
+    // The kernel lists the mappings by address.
+    return result;
+}
+
+void use_huge_pages_for_new_mappings(std::vector<mapping> const & before, size_t const min_size)
+{
+    // A mapping that grew since `before` counts as new.
+    for (mapping const & current : large_mappings(min_size))
+        if (!std::ranges::binary_search(before, current))
+            advise(current.begin, current.end - current.begin);
+
+    update_peak();
+}
+
+size_t huge_page_memory()
+{
+    std::ifstream rollup{"/proc/self/smaps_rollup"};
+    std::string line{};
+
+    while (std::getline(rollup, line))
+    {
+        if (!line.starts_with("AnonHugePages:"))
+            continue;
+
+        std::istringstream fields{line.substr(line.find(':') + 1u)};
+        size_t kibibytes{};
+        fields >> kibibytes;
+        return kibibytes * 1024u;
+    }
+
+    return 0u;
+}
+
+size_t peak_huge_page_memory()
+{
+    return peak.load();
+}
+
+} // namespace utility
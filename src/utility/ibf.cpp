@@ -2,35 +2,103 @@
 // SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include <climits>    // for CHAR_BIT
+#include <cstddef>    // for size_t
 #include <cstring>    // for memcmp
 #include <filesystem> // for path
+#include <memory>     // for shared_ptr
 #include <fstream>    // for basic_ifstream, basic_ofstream, basic_ios, ios, ifstream, ofstream
 #include <string>     // for basic_string
+#include <variant>    // for get, get_if
+#include <vector>     // for vector
 
 #include <fmt/format.h> // for format
 
-#include <hibf/interleaved_bloom_filter.hpp> // for interleaved_bloom_filter
+#include <hibf/hierarchical_interleaved_bloom_filter.hpp> // for hierarchical_interleaved_bloom_filter
+#include <hibf/interleaved_bloom_filter.hpp>              // for interleaved_bloom_filter
 
 #include <cereal/archives/binary.hpp> // for BinaryInputArchive, BinaryOutputArchive
 
-#include <fpgalign/config.hpp>      // for config
-#include <fpgalign/utility/ibf.hpp> // for load, store
+#include <fpgalign/config.hpp>             // for config
+#include <fpgalign/meta.hpp>               // for meta
+#include <fpgalign/utility/container.hpp>  // for open_container, section_kind
+#include <fpgalign/utility/huge_pages.hpp> // for huge_page_size, large_mappings, mapping, use_huge_pages, use_huge...
+#include <fpgalign/utility/ibf.hpp>        // for load, store, memory_usage, prefilter
 
 namespace utility
 {
 
 void store(seqan::hibf::interleaved_bloom_filter const & ibf, config const & config)
 {
-    std::ofstream os{fmt::format("{}.ibf", config.input_path.c_str()), std::ios::binary};
+    std::ofstream os{fmt::format("{}.ibf", config.output_path.c_str()), std::ios::binary};
     cereal::BinaryOutputArchive oarchive{os};
     oarchive(ibf);
 }
 
+void store(seqan::hibf::hierarchical_interleaved_bloom_filter const & hibf, config const & config)
+{
+    std::ofstream os{fmt::format("{}.hibf", config.output_path.c_str()), std::ios::binary};
+    cereal::BinaryOutputArchive oarchive{os};
+    oarchive(hibf);
+}
+
 void load(seqan::hibf::interleaved_bloom_filter & ibf, config const & config)
 {
-    std::ifstream is{fmt::format("{}.ibf", config.input_path.string()), std::ios::binary};
-    cereal::BinaryInputArchive iarchive{is};
-    iarchive(ibf);
+    if (std::shared_ptr<container_reader const> container = open_container(config.input_path))
+    {
+        container->load(section_kind::ibf, 0u, ibf);
+    }
+    else
+    {
+        std::ifstream is{fmt::format("{}.ibf", config.input_path.string()), std::ios::binary};
+        cereal::BinaryInputArchive iarchive{is};
+        iarchive(ibf);
+    }
+
+    if (config.huge_pages)
+        use_huge_pages(ibf.raw_data().data(), ibf.bit_size() / CHAR_BIT);
+}
+
+void load(seqan::hibf::hierarchical_interleaved_bloom_filter & hibf, config const & config)
+{
+    // The hierarchical IBF consists of many IBFs, most of which are smaller than a huge page.
+    size_t const min_mapping_size{8u * huge_page_size};
+    std::vector<mapping> const mappings_before = config.huge_pages ? large_mappings(min_mapping_size)
+                                                                   : std::vector<mapping>{};
+
+    if (std::shared_ptr<container_reader const> container = open_container(config.input_path))
+    {
+        container->load(section_kind::hibf, 0u, hibf);
+    }
+    else
+    {
+        std::ifstream is{fmt::format("{}.hibf", config.input_path.string()), std::ios::binary};
+        cereal::BinaryInputArchive iarchive{is};
+        iarchive(hibf);
+    }
+
+    if (config.huge_pages)
+        use_huge_pages_for_new_mappings(mappings_before, min_mapping_size);
+}
+
+void load(prefilter & filter, config const & config, meta const & meta)
+{
+    if (meta.hierarchical)
+        load(filter.emplace<seqan::hibf::hierarchical_interleaved_bloom_filter>(), config);
+    else
+        load(filter.emplace<seqan::hibf::interleaved_bloom_filter>(), config);
+}
+
+size_t memory_usage(prefilter const & filter)
+{
+    if (auto const * ibf = std::get_if<seqan::hibf::interleaved_bloom_filter>(&filter))
+        return ibf->bit_size() / CHAR_BIT;
+
+    size_t bits{};
+    for (seqan::hibf::interleaved_bloom_filter const & ibf :
+         std::get<seqan::hibf::hierarchical_interleaved_bloom_filter>(filter).ibf_vector)
+        bits += ibf.bit_size();
+    return bits / CHAR_BIT;
 }
 
 } // namespace utility
@@ -4,6 +4,7 @@
 
 #include <cstring>    // for memcmp
 #include <filesystem> // for path
+#include <memory>     // for shared_ptr
 #include <fstream>    // for basic_ifstream, basic_ofstream, basic_ios, ios, ifstream, ofstream
 
 #include <fmt/format.h> // for format
@@ -12,9 +13,10 @@
 #include <cereal/types/string.hpp>    // IWYU pragma: keep
 #include <cereal/types/vector.hpp>    // IWYU pragma: keep
 
-#include <fpgalign/config.hpp>       // for config
-#include <fpgalign/meta.hpp>         // for meta
-#include <fpgalign/utility/meta.hpp> // for load, store
+#include <fpgalign/config.hpp>            // for config
+#include <fpgalign/meta.hpp>              // for meta
+#include <fpgalign/utility/container.hpp> // for open_container, section_kind
+#include <fpgalign/utility/meta.hpp>      // for load, store
 
 namespace utility
 {
@@ -28,6 +30,9 @@ void store(meta const & meta, config const & config)
 
 void load(meta & meta, config const & config)
 {
+    if (std::shared_ptr<container_reader const> container = open_container(config.input_path))
+        return container->load(section_kind::meta, 0u, meta);
+
     std::ifstream is{fmt::format("{}.meta", config.input_path.c_str()), std::ios::binary};
     cereal::BinaryInputArchive iarchive{is};
     iarchive(meta);
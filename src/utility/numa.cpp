@@ -0,0 +1,156 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <linux/mempolicy.h> // for MPOL_DEFAULT, MPOL_INTERLEAVE
+#include <sched.h>           // for sched_getaffinity, sched_setaffinity, cpu_set_t, CPU_ISSET, CPU_SET, CPU_ZERO
+#include <sys/syscall.h>     // for SYS_set_mempolicy
+#include <unistd.h>          // for syscall
+
+#include <algorithm>    // for sort
+#include <charconv>     // for from_chars, from_chars_result
+#include <climits>      // for CHAR_BIT
+#include <cstddef>      // for size_t
+#include <filesystem>   // for directory_iterator, path
+#include <fstream>      // for ifstream
+#include <string>       // for basic_string, string, getline
+#include <system_error> // for errc, error_code
+#include <utility>      // for move
+#include <vector>       // for vector
+
+#include <fpgalign/utility/numa.hpp> // for numa_topology
+
+namespace utility
+{
+
+namespace
+{
+
+// Parses a sysfs CPU list, e.g., `0-15,32-47`.
+std::vector<int> parse_cpu_list(std::string const & list)
+{
+    std::vector<int> cpus{};
+    char const * current = list.data();
+    char const * const last = list.data() + list.size();
+
+    while (current < last)
+    {
+        int first{};
+        std::from_chars_result result = std::from_chars(current, last, first);
+        int second{first};
+        if (result.ec == std::errc{} && result.ptr < last && *result.ptr == '-')
+            result = std::from_chars(result.ptr + 1, last, second);
+        if (result.ec != std::errc{})
+            break;
+
+        for (int cpu = first; cpu <= second; ++cpu)
+            cpus.push_back(cpu);
+
+        current = result.ptr + 1;
+    }
+
+    return cpus;
+}
+
+} // namespace
+
+numa_topology const & numa_topology::system()
+{
+    static numa_topology const topology = []()
+    {
+        numa_topology result{};
+
+        cpu_set_t allowed{};
+        CPU_ZERO(&allowed);
+        bool const has_affinity = ::sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+        std::error_code error{};
+        for (auto const & entry : std::filesystem::directory_iterator{"/sys/devices/system/node", error})
+        {
+            std::string const name = entry.path().filename().string();
+            if (!name.starts_with("node"))
+                continue;
+
+            size_t id{};
+            auto const [end, parse_error] = std::from_chars(name.data() + 4, name.data() + name.size(), id);
+            if (parse_error != std::errc{} || end != name.data() + name.size())
+                continue;
+
+            std::string list{};
+            std::ifstream file{entry.path() / "cpulist"};
+            std::getline(file, list);
+
+            node current{.id = id, .cpus = {}};
+            for (int const cpu : parse_cpu_list(list))
+                if (cpu < CPU_SETSIZE && (!has_affinity || CPU_ISSET(cpu, &allowed)))
+                    current.cpus.push_back(cpu);
+
+            if (!current.cpus.empty())
+                result.nodes.push_back(std::move(current));
+        }
+
+        std::ranges::sort(result.nodes,
+                          [](node const & lhs, node const & rhs)
+                          {
+                              return lhs.id < rhs.id;
+                          });
+
+        // Without topology information, everything is on one node, and pinning does nothing.
+        if (result.nodes.empty())
+            result.nodes.push_back(node{.id = 0u, .cpus = {}});
+
+        return result;
+    }();
+
+    return topology;
+}
+
+// Pinning is only an optimisation, hence failures are ignored.
+void numa_topology::pin_to_node(size_t const node) const
+{
+    if (nodes.size() < 2u)
+        return;
+
+    cpu_set_t cpus{};
+    CPU_ZERO(&cpus);
+    for (int const cpu : nodes[node].cpus)
+        CPU_SET(cpu, &cpus);
+
+    ::sched_setaffinity(0, sizeof(cpus), &cpus);
+}
+
+void numa_topology::unpin() const
+{
+    if (nodes.size() < 2u)
+        return;
+
+    cpu_set_t cpus{};
+    CPU_ZERO(&cpus);
+    for (numa_topology::node const & node : nodes)
+        for (int const cpu : node.cpus)
+            CPU_SET(cpu, &cpus);
+
+    ::sched_setaffinity(0, sizeof(cpus), &cpus);
+}
+
+numa_topology::scoped_interleave::scoped_interleave(numa_topology const & topology)
+{
+    if (topology.nodes.size() < 2u)
+        return;
+
+    constexpr size_t bits = sizeof(unsigned long) * CHAR_BIT;
+    std::vector<unsigned long> mask(topology.nodes.back().id / bits + 1u);
+    for (numa_topology::node const & node : topology.nodes)
+        mask[node.id / bits] |= 1ul << (node.id % bits);
+
+    // The kernel reads one bit less than `maxnode`.
+    active = ::syscall(SYS_set_mempolicy, MPOL_INTERLEAVE, mask.data(), mask.size() * bits + 1u) == 0;
+}
+
+numa_topology::scoped_interleave::~scoped_interleave()
+{
+    if (active)
+        ::syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0ul);
+}
+
+} // namespace utility
@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <fcntl.h>    // for open, posix_fadvise, readahead
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close
+
+#include <cstddef>          // for size_t
+#include <cstdint>          // for uint64_t
+#include <filesystem>       // for path
+#include <initializer_list> // for initializer_list
+#include <mutex>            // for unique_lock
+#include <stop_token>       // for stop_token
+
+#include <fpgalign/utility/container.hpp> // for open_container, section_kind
+#include <fpgalign/utility/fmindex.hpp>   // for fmindex_path
+#include <fpgalign/utility/prefetch.hpp>  // for index_prefetcher
+#include <fpgalign/utility/reference.hpp> // for reference_path
+
+namespace utility
+{
+
+namespace
+{
+
+// Prefetches [offset, offset + size) of the file, or the whole file if size is 0.
+// Failures are ignored: prefetching is only a hint and utility::load reports missing files.
+void prefetch_file(std::filesystem::path const & path, uint64_t const offset, uint64_t size)
+{
+    int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    struct stat status{};
+    if (size == 0u && ::fstat(fd, &status) == 0)
+        size = status.st_size;
+
+    if (size > 0u)
+    {
+        // readahead blocks until the pages are cached, which is what we want on this thread.
+        if (::readahead(fd, offset, size) != 0)
+            ::posix_fadvise(fd, offset, size, POSIX_FADV_WILLNEED);
+    }
+
+    ::close(fd);
+}
+
+} // namespace
+
+index_prefetcher::index_prefetcher(config const & config, size_t const number_of_bins) :
+    input_path{config.input_path},
+    container{open_container(config.input_path)},
+    is_requested(number_of_bins)
+{
+    worker = std::jthread{[this](std::stop_token stop_token)
+                          {
+                              run(stop_token);
+                          }};
+}
+
+void index_prefetcher::request(size_t const bin)
+{
+    {
+        std::unique_lock lock{mutex};
+        if (is_requested[bin])
+            return;
+        is_requested[bin] = true;
+        pending.push_back(bin);
+    }
+    condition.notify_one();
+}
+
+void index_prefetcher::run(std::stop_token const & stop_token)
+{
+    while (true)
+    {
+        std::unique_lock lock{mutex};
+        if (!condition.wait(lock,
+                            stop_token,
+                            [this]()
+                            {
+                                return !pending.empty();
+                            }))
+            return;
+
+        size_t const bin = pending.front();
+        pending.pop_front();
+        lock.unlock();
+
+        prefetch_bin(bin);
+    }
+}
+
+void index_prefetcher::prefetch_bin(size_t const bin) const
+{
+    if (!container)
+    {
+        prefetch_file(fmindex_path(input_path, bin), 0u, 0u);
+        prefetch_file(reference_path(input_path, bin), 0u, 0u);
+        return;
+    }
+
+    for (section_kind const kind : {section_kind::fmindex, section_kind::reference})
+    {
+        if (container->contains(kind, bin))
+        {
+            container_section const & section = container->section(kind, bin);
+            prefetch_file(container->file_path(), section.offset, section.size);
+        }
+    }
+}
+
+} // namespace utility
@@ -5,6 +5,7 @@
 #include <cstdint>    // for uint8_t
 #include <cstring>    // for memcmp, size_t
 #include <filesystem> // for path
+#include <memory>     // for shared_ptr
 #include <fstream>    // for basic_ifstream, basic_ofstream, basic_ios, ios, ifstream, ofstream
 #include <vector>     // for vector
 
@@ -15,21 +16,30 @@
 #include <cereal/types/vector.hpp>    // IWYU pragma: keep
 
 #include <fpgalign/config.hpp>            // for config
-#include <fpgalign/utility/reference.hpp> // for load, store
+#include <fpgalign/utility/container.hpp> // for open_container, section_kind
+#include <fpgalign/utility/reference.hpp> // for load, reference_path, store
 
 namespace utility
 {
 
+std::filesystem::path reference_path(std::filesystem::path const & path, size_t const id)
+{
+    return fmt::format("{}.{}.ref", path.c_str(), id);
+}
+
 void store(std::vector<std::vector<uint8_t>> const & reference, config const & config, size_t const id)
 {
-    std::ofstream os{fmt::format("{}.{}.ref", config.output_path.c_str(), id), std::ios::binary};
+    std::ofstream os{reference_path(config.output_path, id), std::ios::binary};
     cereal::BinaryOutputArchive oarchive{os};
     oarchive(reference);
 }
 
 void load(std::vector<std::vector<uint8_t>> & reference, config const & config, size_t const id)
 {
-    std::ifstream is{fmt::format("{}.{}.ref", config.input_path.c_str(), id), std::ios::binary};
+    if (std::shared_ptr<container_reader const> container = open_container(config.input_path))
+        return container->load(section_kind::reference, id, reference);
+
+    std::ifstream is{reference_path(config.input_path, id), std::ios::binary};
     cereal::BinaryInputArchive iarchive{is};
     iarchive(reference);
 }
@@ -0,0 +1,277 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <algorithm>   // for copy
+#include <array>       // for array
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint8_t
+#include <cstring>     // for memchr
+#include <exception>   // for current_exception, exception_ptr, rethrow_exception
+#include <filesystem>  // for path
+#include <ios>         // for ios
+#include <mutex>       // for unique_lock
+#include <stdexcept>   // for runtime_error
+#include <stop_token>  // for stop_token
+#include <string>      // for string
+#include <string_view> // for string_view
+#include <utility>     // for move, swap
+#include <vector>      // for vector
+
+#include <seqan3/io/detail/misc_input.hpp> // for make_secondary_istream
+#include <seqan3/io/exception.hpp>         // for file_open_error, parse_error
+
+#include <fpgalign/utility/sequence_input.hpp> // for decompressing_streambuf, sequence_input
+
+namespace utility
+{
+
+decompressing_streambuf::decompressing_streambuf(std::filesystem::path & path) :
+    file_name{path.string()},
+    file{path, std::ios::binary}
+{
+    if (!file.good())
+        throw seqan3::file_open_error{"Could not open file " + path.string() + " for reading."};
+
+    decompressed = seqan3::detail::make_secondary_istream(file, path);
+
+    for (std::vector<char> & chunk : buffers)
+        chunk.resize(chunk_size);
+
+    worker = std::jthread{[this](std::stop_token stop_token)
+                          {
+                              produce(stop_token);
+                          }};
+}
+
+void decompressing_streambuf::produce(std::stop_token const & stop_token)
+{
+    while (true)
+    {
+        std::unique_lock lock{mutex};
+        // The consumer may still read chunk `released`, so at most `released + 1` can be filled.
+        if (!condition.wait(lock,
+                            stop_token,
+                            [this]()
+                            {
+                                return filled < released + 2u;
+                            }))
+            return;
+        size_t const slot = filled % 2u;
+        lock.unlock();
+
+        // A corrupt or truncated compressed file sets the badbit and would otherwise look like the end of the file.
+        size_t size{};
+        std::exception_ptr read_error{};
+        try
+        {
+            decompressed->read(buffers[slot].data(), chunk_size);
+            size = decompressed->gcount();
+            if (decompressed->bad())
+                throw std::runtime_error{"Could not decompress " + file_name + ". The file is corrupt or truncated."};
+        }
+        catch (...)
+        {
+            read_error = std::current_exception();
+        }
+
+        lock.lock();
+        sizes[slot] = size;
+        if (read_error)
+            error = read_error;
+        if (size == 0u || read_error)
+            done = true;
+        else
+            ++filled;
+        lock.unlock();
+        condition.notify_all();
+
+        if (size == 0u || read_error)
+            return;
+    }
+}
+
+decompressing_streambuf::int_type decompressing_streambuf::underflow()
+{
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+
+    std::unique_lock lock{mutex};
+
+    if (in_use)
+    {
+        ++released;
+        in_use = false;
+        condition.notify_all();
+    }
+
+    condition.wait(lock,
+                   [this]()
+                   {
+                       return filled > released || done;
+                   });
+
+    if (filled == released)
+    {
+        if (error)
+            std::rethrow_exception(error);
+        return traits_type::eof();
+    }
+
+    in_use = true;
+    char * const begin = buffers[released % 2u].data();
+    setg(begin, begin, begin + sizes[released % 2u]);
+    return traits_type::to_int_type(*gptr());
+}
+
+namespace
+{
+
+// Maps ASCII to the FM-index alphabet (dna4 rank + 1).
+constexpr std::array<uint8_t, 256> fm_ranks = []()
+{
+    std::array<uint8_t, 256> ranks{};
+    ranks.fill(1u);
+    ranks['C'] = ranks['c'] = 2u;
+    ranks['G'] = ranks['g'] = 3u;
+    ranks['T'] = ranks['t'] = ranks['U'] = ranks['u'] = 4u;
+    return ranks;
+}();
+
+void append_encoded(std::string_view const line, std::vector<uint8_t> & sequence)
+{
+    size_t const old_size = sequence.size();
+    sequence.resize(old_size + line.size());
+    uint8_t * out = sequence.data() + old_size;
+    for (char const c : line)
+        *out++ = fm_ranks[static_cast<uint8_t>(c)];
+}
+
+} // namespace
+
+sequence_input::sequence_input(std::filesystem::path path) :
+    format_path{std::move(path)},
+    decompressed{format_path},
+    buffer(initial_capacity)
+{
+    std::string_view line{};
+    while (read_line(line) && line.empty())
+        continue;
+
+    if (line.empty())
+        return;
+
+    if (line.front() != '>' && line.front() != '@')
+        throw seqan3::parse_error{"Expected a FASTA or FASTQ record in " + format_path.string() + "."};
+
+    is_fastq = line.front() == '@';
+    has_next_header = true;
+    next_id.assign(line.substr(1));
+}
+
+bool sequence_input::refill()
+{
+    // Keep the unread part of the buffer and grow it if a single line does not fit.
+    std::copy(buffer.data() + begin, buffer.data() + end, buffer.data());
+    end -= begin;
+    begin = 0u;
+
+    if (end == buffer.size())
+        buffer.resize(2u * buffer.size());
+
+    size_t const read = decompressed.sgetn(buffer.data() + end, buffer.size() - end);
+    end += read;
+    return read != 0u;
+}
+
+bool sequence_input::read_line(std::string_view & line)
+{
+    size_t searched{begin};
+    while (true)
+    {
+        if (void const * newline = std::memchr(buffer.data() + searched, '\n', end - searched))
+        {
+            size_t const line_end = static_cast<char const *>(newline) - buffer.data();
+            line = std::string_view{buffer.data() + begin, line_end - begin};
+            begin = line_end + 1u;
+            break;
+        }
+
+        searched = end - begin;
+        if (!refill())
+        {
+            // The last line may miss its newline.
+            line = std::string_view{buffer.data() + begin, end - begin};
+            begin = end;
+            if (line.empty())
+                return false;
+            break;
+        }
+    }
+
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1u);
+    return true;
+}
+
+bool sequence_input::next(std::vector<uint8_t> & sequence)
+{
+    if (!has_next_header)
+        return false;
+
+    has_next_header = false;
+    std::swap(current_id, next_id);
+    std::string_view line{};
+
+    if (!is_fastq)
+    {
+        while (read_line(line))
+        {
+            if (!line.empty() && line.front() == '>')
+            {
+                has_next_header = true;
+                next_id.assign(line.substr(1));
+                break;
+            }
+            append_encoded(line, sequence);
+        }
+        return true;
+    }
+
+    size_t length{};
+    bool has_qualities{};
+    while (read_line(line))
+    {
+        if (!line.empty() && line.front() == '+')
+        {
+            has_qualities = true;
+            break;
+        }
+        append_encoded(line, sequence);
+        length += line.size();
+    }
+
+    // Qualities may span multiple lines, but have the same length as the sequence.
+    size_t qualities{};
+    while (has_qualities && qualities < length && read_line(line))
+        qualities += line.size();
+
+    if (!has_qualities || qualities != length)
+        throw seqan3::parse_error{"The FASTQ record " + current_id + " in " + format_path.string()
+                                  + " is truncated or its qualities do not match its sequence."};
+
+    while (read_line(line))
+    {
+        if (line.empty())
+            continue;
+        if (line.front() != '@')
+            throw seqan3::parse_error{"Expected a FASTQ record in " + format_path.string() + "."};
+        has_next_header = true;
+        next_id.assign(line.substr(1));
+        break;
+    }
+
+    return true;
+}
+
+} // namespace utility
@@ -0,0 +1,182 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <unistd.h> // for getpid
+
+#include <algorithm>    // for min
+#include <cmath>        // for isnan, pow
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint8_t
+#include <exception>    // for exception
+#include <filesystem>   // for path, create_directories, exists, remove, rename
+#include <fstream>      // for ifstream, ofstream
+#include <ios>          // for ios
+#include <string>       // for basic_string
+#include <system_error> // for error_code
+#include <vector>       // for vector
+
+#include <fmt/format.h> // for format
+
+#include <cereal/archives/binary.hpp> // for BinaryInputArchive, BinaryOutputArchive
+#include <cereal/macros.hpp>          // for CEREAL_SERIALIZE_FUNCTION_NAME
+#include <cereal/types/vector.hpp>    // IWYU pragma: keep
+
+#include <threshold/threshold.hpp>            // for threshold
+#include <threshold/threshold_parameters.hpp> // for threshold_parameters
+
+#include <fpgalign/config.hpp>            // for config
+#include <fpgalign/utility/threshold.hpp> // for cached_threshold, syncmer_threshold, threshold_cache_path
+
+namespace utility
+{
+
+namespace
+{
+
+// threshold::threshold keeps its tables protected, such that derived classes can access them.
+class serialisable_threshold : public threshold::threshold
+{
+public:
+    using threshold::threshold::threshold;
+
+    template <typename archive_t>
+    void CEREAL_SERIALIZE_FUNCTION_NAME(archive_t & archive)
+    {
+        archive(threshold_kind);
+        archive(precomp_correction);
+        archive(precomp_thresholds);
+        archive(kmer_lemma);
+        archive(minimal_number_of_minimizers);
+        archive(maximal_number_of_minimizers);
+        archive(threshold_percentage);
+        archive(errors);
+    }
+};
+
+// Uses the tables of the probabilistic model: the threshold for `n` syncmers is `n` minus the syncmers that may be
+// destroyed.
+class syncmer_model : public threshold::threshold
+{
+public:
+    syncmer_model(::threshold::threshold_parameters const & parameters, uint8_t const syncmer_size)
+    {
+        threshold_kind = threshold_kinds::probabilistic;
+        if (errors = parameters.errors; errors == 0u)
+            return;
+
+        size_t const kmer_size = parameters.shape.size();
+        size_t const kmers_per_pattern =
+            parameters.query_length >= kmer_size ? parameters.query_length - kmer_size + 1u : 0u;
+        size_t const destroyed = destroyed_syncmers(std::min(kmers_per_pattern, errors * kmer_size),
+                                                    1.0 / (kmer_size - syncmer_size + 1u),
+                                                    parameters.tau);
+
+        minimal_number_of_minimizers = 0u;
+        maximal_number_of_minimizers = kmers_per_pattern;
+        precomp_correction.assign(kmers_per_pattern + 1u, 0u);
+        precomp_thresholds.resize(kmers_per_pattern + 1u);
+        for (size_t count = 0; count <= kmers_per_pattern; ++count)
+            precomp_thresholds[count] = count > destroyed ? count - destroyed : 0u;
+    }
+
+private:
+    // The `tau` quantile of the binomial distribution with `kmers` trials and success probability `probability`.
+    static size_t destroyed_syncmers(size_t const kmers, double const probability, double const tau)
+    {
+        double pmf = std::pow(1.0 - probability, kmers);
+        double cdf = pmf;
+        size_t destroyed = 0u;
+
+        while (cdf < tau && destroyed < kmers)
+        {
+            pmf *= (kmers - destroyed) * probability / ((destroyed + 1u) * (1.0 - probability));
+            cdf += pmf;
+            ++destroyed;
+        }
+
+        return destroyed;
+    }
+};
+
+// Only the probabilistic model precomputes tables. The k-mer lemma and percentages are cheap.
+bool is_probabilistic(threshold::threshold_parameters const & parameters)
+{
+    return std::isnan(parameters.percentage) && parameters.window_size != parameters.shape.size()
+        && parameters.errors != 0u;
+}
+
+std::filesystem::path threshold_file(threshold::threshold_parameters const & parameters, config const & config)
+{
+    return threshold_cache_path(config)
+         / fmt::format("k{}_shape{:x}_w{}_l{}_e{}_tau{}_p{}_fpr{}.threshold",
+                       parameters.shape.size(),
+                       parameters.shape.to_ulong(),
+                       parameters.window_size,
+                       parameters.query_length,
+                       parameters.errors,
+                       parameters.tau,
+                       parameters.p_max,
+                       parameters.fpr);
+}
+
+} // namespace
+
+std::filesystem::path threshold_cache_path(config const & config)
+{
+    return fmt::format("{}.thresholds", config.input_path.c_str());
+}
+
+threshold::threshold cached_threshold(threshold::threshold_parameters const & parameters, config const & config)
+{
+    if (!is_probabilistic(parameters))
+        return {parameters};
+
+    std::filesystem::path const path = threshold_file(parameters, config);
+    serialisable_threshold result{};
+
+    // An unreadable file, e.g., from an older version, is recomputed and replaced.
+    if (std::filesystem::exists(path))
+    {
+        try
+        {
+            std::ifstream is{path, std::ios::binary};
+            cereal::BinaryInputArchive iarchive{is};
+            iarchive(result);
+            return result;
+        }
+        catch (std::exception const &)
+        {}
+    }
+
+    result = serialisable_threshold{parameters};
+
+    // Several searches may fill the cache at once. Each writes its own file and renames it, which is atomic.
+    std::error_code error{};
+    std::filesystem::create_directories(path.parent_path(), error);
+    std::filesystem::path temporary_path{path};
+    temporary_path += fmt::format(".{}.tmp", ::getpid());
+
+    try
+    {
+        {
+            std::ofstream os{temporary_path, std::ios::binary};
+            cereal::BinaryOutputArchive oarchive{os};
+            oarchive(result);
+        }
+        std::filesystem::rename(temporary_path, path);
+    }
+    catch (std::exception const &)
+    {
+        std::filesystem::remove(temporary_path, error);
+    }
+
+    return result;
+}
+
+threshold::threshold syncmer_threshold(threshold::threshold_parameters const & parameters, uint8_t const syncmer_size)
+{
+    return syncmer_model{parameters, syncmer_size};
+}
+
+} // namespace utility
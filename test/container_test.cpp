@@ -0,0 +1,131 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <cereal/types/vector.hpp>
+
+#include <fpgalign/utility/container.hpp>
+
+#include "app_test.hpp"
+
+struct container : public app_test
+{
+    using reference_t = std::vector<std::vector<uint8_t>>;
+
+    static inline std::filesystem::path const path{"index.fpgalign"};
+    static inline reference_t const reference_0{{1, 2, 3, 4}, {4, 3, 2, 1, 1}};
+    static inline reference_t const reference_1{{2, 2, 2}};
+
+    static void write_container()
+    {
+        utility::container_writer writer{path};
+        writer.store(utility::section_kind::reference, 0u, reference_0);
+        writer.store(utility::section_kind::reference, 1u, reference_1);
+        writer.finish();
+    }
+
+    // Overwrites the byte at `offset` with its complement.
+    static void flip_byte(uint64_t const offset)
+    {
+        std::fstream file{path, std::ios::binary | std::ios::in | std::ios::out};
+        file.seekg(offset);
+        char const byte = static_cast<char>(file.get());
+        file.seekp(offset);
+        file.put(static_cast<char>(~byte));
+    }
+};
+
+TEST_F(container, round_trip)
+{
+    write_container();
+
+    utility::container_reader const reader{path};
+    EXPECT_TRUE(reader.contains(utility::section_kind::reference, 0u));
+    EXPECT_TRUE(reader.contains(utility::section_kind::reference, 1u));
+    EXPECT_FALSE(reader.contains(utility::section_kind::reference, 2u));
+    EXPECT_FALSE(reader.contains(utility::section_kind::fmindex, 0u));
+
+    reference_t loaded{};
+    reader.load(utility::section_kind::reference, 1u, loaded);
+    EXPECT_EQ(loaded, reference_1);
+    reader.load(utility::section_kind::reference, 0u, loaded);
+    EXPECT_EQ(loaded, reference_0);
+
+    EXPECT_THROW(reader.load(utility::section_kind::fmindex, 0u, loaded), std::runtime_error);
+}
+
+TEST_F(container, sections_are_aligned)
+{
+    write_container();
+
+    utility::container_reader const reader{path};
+    for (size_t const bin : {0u, 1u})
+        EXPECT_EQ(reader.section(utility::section_kind::reference, bin).offset % utility::container_alignment, 0u);
+}
+
+TEST_F(container, corrupted_data)
+{
+    write_container();
+
+    // The last byte of the section is part of the last sequence.
+    {
+        utility::container_reader const reader{path};
+        utility::container_section const & section = reader.section(utility::section_kind::reference, 0u);
+        flip_byte(section.offset + section.size - 1u);
+    }
+
+    utility::container_reader const reader{path};
+    reference_t loaded{};
+    EXPECT_THROW(reader.load(utility::section_kind::reference, 0u, loaded), std::runtime_error);
+
+    // Other sections are not affected.
+    reader.load(utility::section_kind::reference, 1u, loaded);
+    EXPECT_EQ(loaded, reference_1);
+}
+
+TEST_F(container, corrupted_size)
+{
+    write_container();
+
+    // The first byte of the section is the number of sequences. A larger one makes cereal read past the section.
+    {
+        utility::container_reader const reader{path};
+        flip_byte(reader.section(utility::section_kind::reference, 1u).offset);
+    }
+
+    utility::container_reader const reader{path};
+    reference_t loaded{};
+    EXPECT_THROW(reader.load(utility::section_kind::reference, 1u, loaded), std::runtime_error);
+}
+
+TEST_F(container, corrupted_table_of_contents)
+{
+    write_container();
+    flip_byte(std::filesystem::file_size(path) - 1u);
+
+    EXPECT_THROW(utility::container_reader{path}, std::runtime_error);
+}
+
+TEST_F(container, unfinished)
+{
+    {
+        utility::container_writer writer{path};
+        writer.store(utility::section_kind::reference, 0u, reference_0);
+    }
+
+    EXPECT_THROW(utility::container_reader{path}, std::runtime_error);
+}
+
+TEST_F(container, truncated)
+{
+    write_container();
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2u);
+
+    EXPECT_THROW(utility::container_reader{path}, std::runtime_error);
+}
@@ -2,11 +2,781 @@
 // SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
 // SPDX-License-Identifier: BSD-3-Clause
 
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <seqan3/alphabet/cigar/cigar.hpp>
+#include <seqan3/io/sam_file/input.hpp>
+
+#ifdef SEQAN3_HAS_ZLIB
+#    include <seqan3/contrib/stream/bgzf_ostream.hpp>
+#    include <seqan3/contrib/stream/gz_ostream.hpp>
+#endif
+
 #include "app_test.hpp"
 
 // To prevent issues when running multiple CLI tests in parallel, give each CLI test unique names:
 struct fpgalign : public app_test
-{};
+{
+    using fasta_record_t = std::pair<std::string, std::string>;
+    using sam_record_t = std::vector<std::string>;
+
+    static std::string random_sequence(size_t const length, uint64_t const seed)
+    {
+        std::mt19937_64 engine{seed};
+        std::string sequence(length, 'A');
+        for (char & base : sequence)
+            base = "ACGT"[engine() % 4u];
+        return sequence;
+    }
+
+    // Two random references of 400 bp. Each is a bin.
+    static inline std::string const reference_0{random_sequence(400u, 0u)};
+    static inline std::string const reference_1{random_sequence(400u, 1u)};
+
+    static std::string reverse_complement(std::string const & sequence)
+    {
+        std::string result{};
+        for (char const base : sequence | std::views::reverse)
+            result.push_back(base == 'A' ? 'T' : base == 'C' ? 'G' : base == 'G' ? 'C' : 'A');
+        return result;
+    }
+
+    static void write_fasta(std::filesystem::path const & path, std::vector<fasta_record_t> const & records)
+    {
+        std::ofstream file{path};
+        for (auto const & [id, sequence] : records)
+            file << '>' << id << '\n' << sequence << '\n';
+    }
+
+    // Writes the references and a bin list for each number of bins.
+    static void write_references()
+    {
+        write_fasta("reference_0.fasta", {{"reference_0", reference_0}});
+        write_fasta("reference_1.fasta", {{"reference_1", reference_1}});
+        std::ofstream{"one_bin.txt"} << "reference_0.fasta\n";
+        std::ofstream{"two_bins.txt"} << "reference_0.fasta\nreference_1.fasta\n";
+    }
+
+    // The fields of all records. The records are sorted, since their order depends on the scheduling.
+    static std::vector<sam_record_t> sam_records(std::filesystem::path const & path)
+    {
+        std::vector<sam_record_t> records{};
+        std::istringstream sam{string_from_file(path)};
+        std::string line{};
+        while (std::getline(sam, line))
+        {
+            if (line.empty() || line.front() == '@')
+                continue;
+
+            sam_record_t & fields = records.emplace_back();
+            std::istringstream line_stream{line};
+            std::string field{};
+            while (std::getline(line_stream, field, '\t'))
+                fields.push_back(field);
+        }
+        std::ranges::sort(records);
+        return records;
+    }
+
+    // Sends a job to the server listening on `socket_path` and returns the response. Waits for the server to start.
+    static std::string send_job(std::filesystem::path const & socket_path, std::string const & job)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1u);
+
+        int const fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        bool connected{false};
+        for (size_t attempt = 0; attempt < 600u && !connected; ++attempt)
+        {
+            connected = ::connect(fd, reinterpret_cast<sockaddr const *>(&address), sizeof(address)) == 0;
+            if (!connected)
+                std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        }
+
+        std::string response{};
+        if (connected && ::send(fd, job.data(), job.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(job.size()))
+        {
+            char buffer[4096];
+            for (ssize_t received{}; (received = ::recv(fd, buffer, sizeof(buffer), 0)) > 0;)
+                response.append(buffer, received);
+        }
+        ::close(fd);
+        return response;
+    }
+
+    // The query name, flag, and reference name of each record.
+    static std::vector<std::vector<std::string>> alignments(std::vector<sam_record_t> const & records)
+    {
+        std::vector<std::vector<std::string>> result{};
+        for (sam_record_t const & record : records)
+            result.push_back({record[0], record[1], record[2]});
+        return result;
+    }
+};
 
 TEST_F(fpgalign, no_options)
 {}
+
+TEST_F(fpgalign, fastq_query)
+{
+    write_references();
+    write_fasta("query.fasta", {{"read_0", reference_0.substr(20u, 50u)}, {"read_1", reference_1.substr(100u, 50u)}});
+    // The same reads as multi-line FASTQ with Windows line endings and IDs on the `+` lines.
+    std::ofstream{"query.fastq", std::ios::binary} << "@read_0\r\n"
+                                                   << reference_0.substr(20u, 25u) << "\r\n"
+                                                   << reference_0.substr(45u, 25u) << "\r\n+read_0\r\n"
+                                                   << std::string(50u, 'I') << "\r\n@read_1\r\n"
+                                                   << reference_1.substr(100u, 50u) << "\r\n+read_1\r\n"
+                                                   << std::string(25u, '@') << "\r\n"
+                                                   << std::string(25u, '+') << "\r\n";
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fasta", "--output fasta.sam"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fastq", "--output fastq.sam"));
+
+    EXPECT_EQ(alignments(sam_records("fasta.sam")),
+              (std::vector<std::vector<std::string>>{{"read_0", "0", "reference_0"},
+                                                     {"read_1", "0", "reference_1"}}));
+    EXPECT_EQ(alignments(sam_records("fastq.sam")), alignments(sam_records("fasta.sam")));
+}
+
+TEST_F(fpgalign, serve)
+{
+    write_references();
+    write_fasta("query.fasta",
+                {{"read_0", reference_0.substr(20u, 50u)},
+                 {"read_1", reverse_complement(reference_1.substr(100u, 50u))},
+                 {"read_2", reference_0.substr(20u, 50u)}});
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fasta", "--output search.sam"));
+
+    // The server runs in the background until it is stopped.
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "serve",
+                               "--input index",
+                               "--socket serve.sock",
+                               "> serve.log 2>&1 & echo $! > serve.pid"));
+    pid_t const server = std::stoi(string_from_file("serve.pid"));
+
+    std::ofstream{"first_job.sam"} << send_job("serve.sock", "query query.fasta\n\n");
+    std::ofstream{"second_job.sam"} << send_job("serve.sock", "query query.fasta\ncollapse-duplicates 1\n\n");
+    std::string const invalid_job = send_job("serve.sock", "query query.fasta\nbin-major 1\n\n");
+    ::kill(server, SIGTERM);
+
+    EXPECT_EQ(alignments(sam_records("search.sam")),
+              (std::vector<std::vector<std::string>>{{"read_0", "0", "reference_0"},
+                                                     {"read_1", "16", "reference_1"},
+                                                     {"read_2", "0", "reference_0"}}));
+    EXPECT_EQ(sam_records("first_job.sam"), sam_records("search.sam"));
+    EXPECT_EQ(sam_records("second_job.sam"), sam_records("search.sam"));
+    EXPECT_EQ(invalid_job, "ERROR Unknown job option: bin-major\n");
+}
+
+TEST_F(fpgalign, merge)
+{
+    write_references();
+    write_fasta("query.fasta",
+                {{"read_0", reference_0.substr(20u, 50u)},
+                 {"read_1", reverse_complement(reference_1.substr(100u, 50u))}});
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fasta", "--output expected.sam"));
+
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "build",
+                               "--input two_bins.txt",
+                               "--output shards",
+                               "--kmer 15",
+                               "--bins 0..1",
+                               "--max-elements 1000"));
+    // Not all shards are built yet.
+    app_test_result const missing = execute_app("FPGAlign", "merge", "--index shards");
+    EXPECT_FAILURE(missing);
+    EXPECT_NE(missing.err.find("The bins 1..2 are not covered by any shard. The last shard is ./shards.0-1."),
+              std::string::npos)
+        << missing.err;
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "build",
+                               "--input two_bins.txt",
+                               "--output shards",
+                               "--kmer 15",
+                               "--bins 1..2",
+                               "--max-elements 1000"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "merge", "--index shards"));
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input shards", "--query query.fasta", "--output merged.sam"));
+    EXPECT_EQ(alignments(sam_records("merged.sam")),
+              (std::vector<std::vector<std::string>>{{"read_0", "0", "reference_0"},
+                                                     {"read_1", "16", "reference_1"}}));
+    EXPECT_EQ(alignments(sam_records("merged.sam")), alignments(sam_records("expected.sam")));
+    // Overlapping shards are named in the error.
+    for (std::string const bins : {"0..2", "1..2"})
+        EXPECT_SUCCESS(execute_app("FPGAlign",
+                                   "build",
+                                   "--input two_bins.txt",
+                                   "--output overlapping",
+                                   "--kmer 15",
+                                   "--bins " + bins,
+                                   "--max-elements 1000"));
+    app_test_result const overlapping = execute_app("FPGAlign", "merge", "--index overlapping");
+    EXPECT_FAILURE(overlapping);
+    EXPECT_NE(overlapping.err.find("The shards ./overlapping.0-2 and ./overlapping.1-2 overlap in the bins 1..2."),
+              std::string::npos)
+        << overlapping.err;
+}
+
+TEST_F(fpgalign, merge_results)
+{
+    write_references();
+    write_fasta("query.fasta",
+                {{"read_0", reference_0.substr(20u, 50u)},
+                 {"read_1", reverse_complement(reference_1.substr(100u, 50u))}});
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fasta", "--output expected.sam"));
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "search",
+                               "--input index",
+                               "--query query.fasta",
+                               "--output shard_0.sam",
+                               "--bins 0..1"));
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "search",
+                               "--input index",
+                               "--query query.fasta",
+                               "--output shard_1.sam",
+                               "--bins 1..2"));
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "merge-results",
+                               "--input shard_0.sam",
+                               "--input shard_1.sam",
+                               "--output merged.sam"));
+
+    EXPECT_EQ(alignments(sam_records("merged.sam")),
+              (std::vector<std::vector<std::string>>{{"read_0", "0", "reference_0"},
+                                                     {"read_1", "16", "reference_1"}}));
+    EXPECT_EQ(alignments(sam_records("merged.sam")), alignments(sam_records("expected.sam")));
+}
+
+TEST_F(fpgalign, merge_results_paired_end)
+{
+    // The pair has one error in bin 0 and two errors in bin 1.
+    auto substitute = [](std::string sequence, std::vector<size_t> const & positions)
+    {
+        for (size_t const position : positions)
+            sequence[position] = sequence[position] == 'A' ? 'C' : 'A';
+        return sequence;
+    };
+    std::string const genome{random_sequence(400u, 2u)};
+    write_fasta("one_error.fasta", {{"one_error", substitute(genome, {30u})}});
+    write_fasta("two_errors.fasta", {{"two_errors", substitute(genome, {30u, 40u})}});
+    std::ofstream{"bins.txt"} << "one_error.fasta\ntwo_errors.fasta\n";
+    write_fasta("query_1.fasta", {{"pair", genome.substr(20u, 50u)}});
+    write_fasta("query_2.fasta", {{"pair", reverse_complement(genome.substr(200u, 50u))}});
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input bins.txt", "--output index", "--kmer 15"));
+    for (std::string const shard : {"0..1", "1..2"})
+        EXPECT_SUCCESS(execute_app("FPGAlign",
+                                   "search",
+                                   "--input index",
+                                   "--query query_1.fasta",
+                                   "--query2 query_2.fasta",
+                                   "--errors 2",
+                                   "--output shard_" + shard.substr(0u, 1u) + ".sam",
+                                   "--bins " + shard));
+
+    EXPECT_EQ(alignments(sam_records("shard_1.sam")),
+              (std::vector<std::vector<std::string>>{{"pair", "147", "two_errors"}, {"pair", "99", "two_errors"}}));
+
+    // Repeated records of a mate are counted once. Otherwise, the pair in bin 0 would have two errors, too.
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "merge-results",
+                               "--input shard_0.sam",
+                               "--input shard_0.sam",
+                               "--input shard_1.sam",
+                               "--output merged.sam"));
+    EXPECT_EQ(alignments(sam_records("merged.sam")),
+              (std::vector<std::vector<std::string>>{{"pair", "147", "one_error"},
+                                                     {"pair", "147", "one_error"},
+                                                     {"pair", "99", "one_error"},
+                                                     {"pair", "99", "one_error"}}));
+}
+
+TEST_F(fpgalign, exact_search)
+{
+    write_references();
+    write_fasta("query.fasta",
+                {{"read_0", reference_0.substr(20u, 50u)},
+                 {"read_1", reverse_complement(reference_1.substr(100u, 50u))},
+                 {"read_2", reference_1.substr(300u, 50u)},
+                 {"unmapped", random_sequence(50u, 3u)}});
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fasta", "--output out.sam"));
+
+    std::vector<sam_record_t> const records = sam_records("out.sam");
+    EXPECT_EQ(alignments(records),
+              (std::vector<std::vector<std::string>>{{"read_0", "0", "reference_0"},
+                                                     {"read_1", "16", "reference_1"},
+                                                     {"read_2", "0", "reference_1"}}));
+    // 1-based positions.
+    EXPECT_EQ(records[0][3], "21");
+    EXPECT_EQ(records[1][3], "101");
+    EXPECT_EQ(records[2][3], "301");
+}
+
+TEST_F(fpgalign, batched_search)
+{
+    write_references();
+    // More reads than fit in a batch, such that the last batch is partially filled.
+    std::vector<fasta_record_t> reads{};
+    for (size_t i = 0; i < 40u; ++i)
+    {
+        std::string const & reference = i % 2u == 0u ? reference_0 : reference_1;
+        std::string const read = reference.substr(i * 8u, 50u);
+        reads.emplace_back("read_" + std::to_string(i), i % 3u == 0u ? reverse_complement(read) : read);
+    }
+    write_fasta("query.fasta", reads);
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fasta", "--output batched.sam"));
+    // A batch of one query is searched like a single query.
+    for (std::string const batch_size : {"1", "7"})
+        EXPECT_SUCCESS(execute_app("FPGAlign",
+                                   "search",
+                                   "--input index",
+                                   "--query query.fasta",
+                                   "--output batch_size_" + batch_size + ".sam",
+                                   "--batch-size " + batch_size));
+
+    std::vector<sam_record_t> const records = sam_records("batched.sam");
+    EXPECT_EQ(records.size(), reads.size());
+    EXPECT_EQ(sam_records("batch_size_1.sam"), records);
+    EXPECT_EQ(sam_records("batch_size_7.sam"), records);
+}
+
+TEST_F(fpgalign, errors)
+{
+    auto substitute = [](std::string sequence, std::vector<size_t> const & positions)
+    {
+        for (size_t const position : positions)
+            sequence[position] = sequence[position] == 'A' ? 'C' : 'A';
+        return sequence;
+    };
+
+    // With errors, a read may be found at several nearby positions. Each read is listed once with its fewest errors.
+    auto best_alignments = [](std::vector<sam_record_t> const & records)
+    {
+        std::vector<std::vector<std::string>> result{};
+        for (sam_record_t const & record : records)
+        {
+            std::string const errors = *std::ranges::find_if(record,
+                                                            [](std::string const & field)
+                                                            {
+                                                                return field.starts_with("NM:i:");
+                                                            });
+            if (result.empty() || result.back()[0] != record[0])
+                result.push_back({record[0], record[1], record[2], errors});
+            else
+                result.back()[3] = std::min(result.back()[3], errors);
+        }
+        return result;
+    };
+
+    write_references();
+    write_fasta("query.fasta",
+                {{"exact", reference_0.substr(20u, 50u)},
+                 {"one_error", substitute(reference_0.substr(150u, 50u), {25u})},
+                 {"two_errors", reverse_complement(substitute(reference_1.substr(100u, 50u), {10u, 40u}))}});
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    // Each error count has its own search and alignment kernel.
+    for (std::string const errors : {"0", "1", "2"})
+        EXPECT_SUCCESS(execute_app("FPGAlign",
+                                   "search",
+                                   "--input index",
+                                   "--query query.fasta",
+                                   "--output errors_" + errors + ".sam",
+                                   "--errors " + errors));
+
+    EXPECT_EQ(best_alignments(sam_records("errors_0.sam")),
+              (std::vector<std::vector<std::string>>{{"exact", "0", "reference_0", "NM:i:0"}}));
+    EXPECT_EQ(best_alignments(sam_records("errors_1.sam")),
+              (std::vector<std::vector<std::string>>{{"exact", "0", "reference_0", "NM:i:0"},
+                                                     {"one_error", "0", "reference_0", "NM:i:1"}}));
+    EXPECT_EQ(best_alignments(sam_records("errors_2.sam")),
+              (std::vector<std::vector<std::string>>{{"exact", "0", "reference_0", "NM:i:0"},
+                                                     {"one_error", "0", "reference_0", "NM:i:1"},
+                                                     {"two_errors", "16", "reference_1", "NM:i:2"}}));
+}
+
+TEST_F(fpgalign, seed_and_extend)
+{
+    // Substitutes every 30th base, starting at `first`.
+    auto substitute = [](std::string sequence, size_t const first)
+    {
+        for (size_t position = first; position < sequence.size(); position += 30u)
+            sequence[position] = sequence[position] == 'A' ? 'C' : 'A';
+        return sequence;
+    };
+
+    write_references();
+    write_fasta("query.fasta",
+                {{"long_0", substitute(reference_0.substr(20u, 300u), 15u)},
+                 {"long_1", reverse_complement(substitute(reference_1.substr(50u, 240u), 5u))},
+                 {"too_short", reference_0.substr(0u, 15u)}});
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    app_test_result const result = execute_app("FPGAlign",
+                                               "search",
+                                               "--input index",
+                                               "--query query.fasta",
+                                               "--output out.sam",
+                                               "--seed-length 20");
+    EXPECT_SUCCESS(result);
+    EXPECT_NE(result.err.find("1 queries are shorter than --seed-length"), std::string::npos) << result.err;
+
+    std::vector<sam_record_t> const records = sam_records("out.sam");
+    EXPECT_EQ(alignments(records),
+              (std::vector<std::vector<std::string>>{{"long_0", "0", "reference_0"},
+                                                     {"long_1", "16", "reference_1"}}));
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0][3], "21");
+    EXPECT_NE(std::ranges::find(records[0], "NM:i:10"), records[0].end());
+    EXPECT_EQ(records[1][3], "51");
+    EXPECT_NE(std::ranges::find(records[1], "NM:i:8"), records[1].end());
+
+    // Seed-and-extend does not support paired-end queries.
+    EXPECT_FAILURE(execute_app("FPGAlign",
+                               "search",
+                               "--input index",
+                               "--query query.fasta",
+                               "--query2 query.fasta",
+                               "--output paired.sam",
+                               "--seed-length 20"));
+}
+
+TEST_F(fpgalign, paired_end)
+{
+    write_references();
+    // Mate 2 is on the reverse strand, 180 bp downstream of mate 1.
+    write_fasta("query_1.fasta", {{"pair", reference_0.substr(20u, 50u)}});
+    write_fasta("query_2.fasta", {{"pair", reverse_complement(reference_0.substr(200u, 50u))}});
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "search",
+                               "--input index",
+                               "--query query_1.fasta",
+                               "--query2 query_2.fasta",
+                               "--output out.sam"));
+
+    // 99: paired, proper pair, mate reverse, first in pair. 147: paired, proper pair, reverse, second in pair.
+    EXPECT_EQ(alignments(sam_records("out.sam")),
+              (std::vector<std::vector<std::string>>{{"pair", "147", "reference_0"}, {"pair", "99", "reference_0"}}));
+
+    // An insert size of 230 bp exceeds the maximum.
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "search",
+                               "--input index",
+                               "--query query_1.fasta",
+                               "--query2 query_2.fasta",
+                               "--output too_far.sam",
+                               "--max-insert-size 200"));
+    EXPECT_TRUE(sam_records("too_far.sam").empty());
+}
+
+TEST_F(fpgalign, bam_output)
+{
+    write_references();
+    write_fasta("query.fasta",
+                {{"read_0", reference_0.substr(20u, 50u)},
+                 {"read_1", reverse_complement(reference_1.substr(100u, 50u))}});
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fasta", "--output out.sam"));
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "search",
+                               "--input index",
+                               "--query query.fasta",
+                               "--output out.bam",
+                               "--threads 2"));
+
+    // BAM is BGZF compressed, which starts with the gzip magic bytes.
+    std::string const bam = string_from_file("out.bam", std::ios::binary);
+    ASSERT_GE(bam.size(), 2u);
+    EXPECT_EQ(bam.substr(0u, 2u), "\x1f\x8b");
+
+    using bam_fields = seqan3::fields<seqan3::field::id,
+                                      seqan3::field::flag,
+                                      seqan3::field::ref_id,
+                                      seqan3::field::ref_offset,
+                                      seqan3::field::cigar>;
+    seqan3::sam_file_input input{std::filesystem::path{"out.bam"}, bam_fields{}};
+    std::vector<std::vector<std::string>> bam_records{};
+    for (auto & record : input)
+    {
+        ASSERT_TRUE(record.reference_id().has_value());
+        ASSERT_TRUE(record.reference_position().has_value());
+        std::string cigar{};
+        for (seqan3::cigar const & element : record.cigar_sequence())
+            cigar += std::to_string(element.get<uint32_t>()) + element.get<seqan3::cigar::operation>().to_char();
+        bam_records.push_back({record.id(),
+                               std::to_string(static_cast<uint16_t>(record.flag())),
+                               input.header().ref_ids()[*record.reference_id()],
+                               std::to_string(*record.reference_position() + 1),
+                               cigar});
+    }
+    std::ranges::sort(bam_records);
+
+    // The query name, flag, reference, position and CIGAR of each record.
+    std::vector<std::vector<std::string>> sam{};
+    for (sam_record_t const & record : sam_records("out.sam"))
+        sam.push_back({record[0], record[1], record[2], record[3], record[5]});
+    EXPECT_EQ(bam_records, sam);
+}
+
+#ifdef SEQAN3_HAS_ZLIB
+TEST_F(fpgalign, compressed_input)
+{
+    // Compresses `path` to `path.gz` with gzip, or to `path.bgzf` with BGZF.
+    auto compress = [](std::filesystem::path const & path, bool const bgzf)
+    {
+        std::string const content = string_from_file(path);
+        std::filesystem::path compressed_path{path};
+        std::ofstream file{compressed_path += bgzf ? ".bgzf" : ".gz", std::ios::binary};
+        if (bgzf)
+            seqan3::contrib::bgzf_ostream{file} << content;
+        else
+            seqan3::contrib::gz_ostream{file} << content;
+    };
+
+    write_references();
+    write_fasta("query.fasta",
+                {{"read_0", reference_0.substr(20u, 50u)},
+                 {"read_1", reverse_complement(reference_1.substr(100u, 50u))}});
+    compress("reference_0.fasta", true);
+    compress("reference_1.fasta", false);
+    compress("query.fasta", false);
+    std::ofstream{"compressed_bins.txt"} << "reference_0.fasta.bgzf\nreference_1.fasta.gz\n";
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fasta", "--output expected.sam"));
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "build",
+                               "--input compressed_bins.txt",
+                               "--output compressed",
+                               "--kmer 15",
+                               "--threads 2"));
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "search",
+                               "--input compressed",
+                               "--query query.fasta.gz",
+                               "--output compressed.sam",
+                               "--threads 2"));
+
+    EXPECT_EQ(alignments(sam_records("expected.sam")),
+              (std::vector<std::vector<std::string>>{{"read_0", "0", "reference_0"},
+                                                     {"read_1", "16", "reference_1"}}));
+    EXPECT_EQ(sam_records("compressed.sam"), sam_records("expected.sam"));
+}
+#endif
+
+TEST_F(fpgalign, collapse_duplicates)
+{
+    write_references();
+    write_fasta("query.fasta",
+                {{"read_0", reference_0.substr(20u, 50u)},
+                 {"read_1", reference_1.substr(100u, 50u)},
+                 {"duplicate_of_read_0", reference_0.substr(20u, 50u)}});
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fasta", "--output all.sam"));
+    EXPECT_SUCCESS(execute_app("FPGAlign",
+                               "search",
+                               "--input index",
+                               "--query query.fasta",
+                               "--output collapsed.sam",
+                               "--collapse-duplicates"));
+
+    // Each duplicate still has its own record.
+    std::vector<sam_record_t> const records = sam_records("collapsed.sam");
+    EXPECT_EQ(alignments(records),
+              (std::vector<std::vector<std::string>>{{"duplicate_of_read_0", "0", "reference_0"},
+                                                     {"read_0", "0", "reference_0"},
+                                                     {"read_1", "0", "reference_1"}}));
+    EXPECT_EQ(records, sam_records("all.sam"));
+}
+
+TEST_F(fpgalign, bin_major)
+{
+    write_references();
+    std::vector<fasta_record_t> reads{};
+    for (size_t i = 0; i < 40u; ++i)
+    {
+        std::string const & reference = i % 2u == 0u ? reference_0 : reference_1;
+        std::string const read = reference.substr(i * 8u, 50u);
+        reads.emplace_back("read_" + std::to_string(i), i % 3u == 0u ? reverse_complement(read) : read);
+    }
+    write_fasta("query.fasta", reads);
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15"));
+    for (std::string const errors : {"0", "1"})
+    {
+        EXPECT_SUCCESS(execute_app("FPGAlign",
+                                   "search",
+                                   "--input index",
+                                   "--query query.fasta",
+                                   "--output default_" + errors + ".sam",
+                                   "--errors " + errors,
+                                   "--threads 2"));
+        EXPECT_SUCCESS(execute_app("FPGAlign",
+                                   "search",
+                                   "--input index",
+                                   "--query query.fasta",
+                                   "--output bin_major_" + errors + ".sam",
+                                   "--errors " + errors,
+                                   "--threads 2",
+                                   "--bin-major"));
+
+        std::vector<sam_record_t> const records = sam_records("default_" + errors + ".sam");
+        EXPECT_GE(records.size(), reads.size());
+        EXPECT_EQ(sam_records("bin_major_" + errors + ".sam"), records);
+        // The IBF results are removed after the search.
+        EXPECT_FALSE(std::filesystem::exists("bin_major_" + errors + ".sam.spill"));
+    }
+}
+
+TEST_F(fpgalign, update)
+{
+    write_references();
+    write_fasta("query.fasta",
+                {{"read_0", reference_0.substr(20u, 50u)},
+                 {"read_1", reverse_complement(reference_1.substr(100u, 50u))}});
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input one_bin.txt", "--output index", "--kmer 15"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fasta", "--output before.sam"));
+    EXPECT_EQ(alignments(sam_records("before.sam")),
+              (std::vector<std::vector<std::string>>{{"read_0", "0", "reference_0"}}));
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "update", "--input two_bins.txt", "--index index"));
+    // Bins cannot be removed.
+    EXPECT_FAILURE(execute_app("FPGAlign", "update", "--input one_bin.txt", "--index index"));
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fasta", "--output after.sam"));
+    EXPECT_EQ(alignments(sam_records("after.sam")),
+              (std::vector<std::vector<std::string>>{{"read_0", "0", "reference_0"},
+                                                     {"read_1", "16", "reference_1"}}));
+}
+
+TEST_F(fpgalign, threshold_cache)
+{
+    write_references();
+    write_fasta("query.fasta",
+                {{"read_0", reference_0.substr(20u, 50u)},
+                 {"read_1", reverse_complement(reference_1.substr(100u, 50u))}});
+
+    // Only minimisers with errors use the probabilistic threshold, whose tables are cached.
+    EXPECT_SUCCESS(
+        execute_app("FPGAlign", "build", "--input two_bins.txt", "--output index", "--kmer 15", "--window 20"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "search", "--input index", "--query query.fasta", "--output exact.sam"));
+    EXPECT_FALSE(std::filesystem::exists("index.thresholds"));
+
+    auto search = [&](std::string const & output)
+    {
+        EXPECT_SUCCESS(execute_app("FPGAlign",
+                                   "search",
+                                   "--input index",
+                                   "--query query.fasta",
+                                   "--output " + output,
+                                   "--errors 1"));
+    };
+
+    auto cached_files = []()
+    {
+        std::vector<std::filesystem::path> files{};
+        for (auto const & entry : std::filesystem::directory_iterator{"index.thresholds"})
+            files.push_back(entry.path());
+        return files;
+    };
+
+    search("computed.sam");
+    std::vector<std::filesystem::path> const files = cached_files();
+    ASSERT_EQ(files.size(), 1u);
+    EXPECT_EQ(files[0].extension(), ".threshold");
+    std::string const table = string_from_file(files[0], std::ios::binary);
+
+    search("cached.sam");
+    EXPECT_EQ(cached_files(), files);
+
+    // An unreadable table is recomputed and replaced.
+    std::ofstream{files[0], std::ios::binary | std::ios::trunc} << "corrupt";
+    search("recomputed.sam");
+    EXPECT_EQ(string_from_file(files[0], std::ios::binary), table);
+
+    EXPECT_EQ(alignments(sam_records("computed.sam")),
+              (std::vector<std::vector<std::string>>{{"read_0", "0", "reference_0"},
+                                                     {"read_1", "16", "reference_1"}}));
+    EXPECT_EQ(sam_records("cached.sam"), sam_records("computed.sam"));
+    EXPECT_EQ(sam_records("recomputed.sam"), sam_records("computed.sam"));
+}
+
+TEST_F(fpgalign, hibf)
+{
+    // Enough bins for the hierarchical IBF to have more than one level.
+    std::vector<std::string> references{};
+    std::ofstream bins{"bins.txt"};
+    for (size_t i = 0; i < 96u; ++i)
+    {
+        std::string const id = "reference_" + std::to_string(i);
+        references.push_back(random_sequence(i == 0u ? 4000u : 400u, i + 10u));
+        write_fasta(id + ".fasta", {{id, references.back()}});
+        bins << id << ".fasta\n";
+    }
+    bins.close();
+
+    std::vector<fasta_record_t> reads{};
+    for (size_t i = 0; i < references.size(); i += 7u)
+        reads.emplace_back("read_" + std::to_string(i), reverse_complement(references[i].substr(100u, 50u)));
+    write_fasta("query.fasta", reads);
+
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input bins.txt", "--output ibf", "--kmer 15"));
+    EXPECT_SUCCESS(execute_app("FPGAlign", "build", "--input bins.txt", "--output hibf", "--kmer 15", "--hibf"));
+    EXPECT_TRUE(std::filesystem::exists("hibf.hibf"));
+    EXPECT_FALSE(std::filesystem::exists("hibf.ibf"));
+
+    for (std::string const errors : {"0", "1"})
+    {
+        for (std::string const index : {"ibf", "hibf"})
+            EXPECT_SUCCESS(execute_app("FPGAlign",
+                                       "search",
+                                       "--input " + index,
+                                       "--query query.fasta",
+                                       "--output " + index + '_' + errors + ".sam",
+                                       "--errors " + errors));
+
+        std::vector<sam_record_t> const records = sam_records("hibf_" + errors + ".sam");
+        EXPECT_GE(records.size(), reads.size());
+        EXPECT_EQ(records, sam_records("ibf_" + errors + ".sam"));
+    }
+}
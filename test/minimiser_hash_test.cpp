@@ -0,0 +1,164 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <ranges>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include <seqan3/alphabet/nucleotide/dna4.hpp>
+
+#include <fpgalign/contrib/minimiser_hash.hpp>
+
+#include "app_test.hpp"
+
+struct minimiser_hash : public app_test
+{
+    using sequence_t = std::vector<seqan3::dna4>;
+    using hashes_t = std::vector<uint64_t>;
+
+    static sequence_t random_sequence(size_t const length)
+    {
+        std::mt19937_64 engine{42u};
+        sequence_t sequence(length);
+        for (seqan3::dna4 & base : sequence)
+            base.assign_rank(engine() % 4u);
+        return sequence;
+    }
+
+    static sequence_t reverse_complement(sequence_t const & sequence)
+    {
+        sequence_t result(sequence.size());
+        std::ranges::transform(sequence | std::views::reverse,
+                               result.begin(),
+                               [](seqan3::dna4 const base)
+                               {
+                                   return seqan3::dna4{}.assign_rank(3u - base.to_rank());
+                               });
+        return result;
+    }
+
+    static hashes_t hashes(sequence_t const & sequence, contrib::minimiser_hash_parameters const & params)
+    {
+        hashes_t result{};
+        std::ranges::copy(sequence | contrib::views::minimiser_hash(params), std::back_inserter(result));
+        return result;
+    }
+
+    // Iterates with a const iterator that was converted from a non-const one.
+    static hashes_t converted_hashes(sequence_t const & sequence, contrib::minimiser_hash_parameters const & params)
+    {
+        auto view = sequence | contrib::views::minimiser_hash(params);
+        hashes_t result{};
+        for (std::ranges::iterator_t<decltype(view) const> it = view.begin(); it != std::default_sentinel; ++it)
+            result.push_back(*it);
+        return result;
+    }
+
+    static std::set<uint64_t> as_set(hashes_t const & values)
+    {
+        return {values.begin(), values.end()};
+    }
+};
+
+TEST_F(minimiser_hash, gapped_shape)
+{
+    // Only the first, third and fifth position are hashed.
+    contrib::minimiser_hash_parameters const params{.kmer_size = 5u, .window_size = 5u, .shape = 0b10101};
+
+    sequence_t const sequence{random_sequence(5u)};
+    sequence_t masked_changed{sequence};
+    masked_changed[1].assign_rank((sequence[1].to_rank() + 1u) % 4u);
+    masked_changed[3].assign_rank((sequence[3].to_rank() + 2u) % 4u);
+    sequence_t hashed_changed{sequence};
+    hashed_changed[2].assign_rank((sequence[2].to_rank() + 1u) % 4u);
+
+    hashes_t const expected{hashes(sequence, params)};
+    ASSERT_EQ(expected.size(), 1u);
+    EXPECT_EQ(hashes(masked_changed, params), expected);
+    EXPECT_NE(hashes(hashed_changed, params), expected);
+
+    // The ungapped shape of the same size is the same as no shape.
+    EXPECT_EQ(hashes(sequence, {.kmer_size = 5u, .window_size = 5u, .shape = 0b11111}),
+              hashes(sequence, {.kmer_size = 5u, .window_size = 5u}));
+}
+
+TEST_F(minimiser_hash, syncmers)
+{
+    // With a window of one k-mer, every k-mer is a minimiser.
+    contrib::minimiser_hash_parameters const kmer_params{.kmer_size = 15u, .window_size = 15u};
+    contrib::minimiser_hash_parameters const syncmer_params{.kmer_size = 15u, .window_size = 15u, .syncmer_size = 7u};
+
+    sequence_t const sequence{random_sequence(1000u)};
+    hashes_t const kmers{hashes(sequence, kmer_params)};
+    hashes_t const syncmers{hashes(sequence, syncmer_params)};
+
+    // Syncmers are a proper subset of the k-mers, in the same order.
+    EXPECT_FALSE(syncmers.empty());
+    EXPECT_LT(syncmers.size(), kmers.size());
+    auto kmer_it = kmers.begin();
+    for (uint64_t const syncmer : syncmers)
+    {
+        kmer_it = std::ranges::find(kmer_it, kmers.end(), syncmer);
+        ASSERT_NE(kmer_it, kmers.end());
+        ++kmer_it;
+    }
+}
+
+TEST_F(minimiser_hash, both_strands)
+{
+    sequence_t const sequence{random_sequence(1000u)};
+    sequence_t const reverse{reverse_complement(sequence)};
+
+    // The shape must be symmetric, otherwise the strands hash different positions.
+    for (contrib::minimiser_hash_parameters const & params :
+         {contrib::minimiser_hash_parameters{.kmer_size = 19u, .window_size = 25u},
+          contrib::minimiser_hash_parameters{.kmer_size = 19u, .window_size = 25u, .shape = 0b1101100111110011011},
+          contrib::minimiser_hash_parameters{.kmer_size = 21u, .window_size = 21u, .syncmer_size = 11u},
+          contrib::minimiser_hash_parameters{.kmer_size = 21u,
+                                             .window_size = 21u,
+                                             .shape = 0b110110101111101011011,
+                                             .syncmer_size = 11u}})
+    {
+        hashes_t const forward_hashes{hashes(sequence, params)};
+        hashes_t reverse_hashes{hashes(reverse, params)};
+        EXPECT_EQ(as_set(forward_hashes), as_set(reverse_hashes));
+
+        // Each k-mer is sampled on its own: the reverse strand yields the same syncmers in reverse order.
+        if (params.syncmer_size != 0u)
+        {
+            std::ranges::reverse(reverse_hashes);
+            EXPECT_EQ(forward_hashes, reverse_hashes);
+        }
+    }
+}
+
+TEST_F(minimiser_hash, const_iterator)
+{
+    sequence_t const sequence{random_sequence(1000u)};
+
+    for (contrib::minimiser_hash_parameters const & params :
+         {contrib::minimiser_hash_parameters{.kmer_size = 19u, .window_size = 25u},
+          contrib::minimiser_hash_parameters{.kmer_size = 19u, .window_size = 25u, .shape = 0b1101100111110011011},
+          contrib::minimiser_hash_parameters{.kmer_size = 21u, .window_size = 21u, .syncmer_size = 11u}})
+    {
+        EXPECT_EQ(converted_hashes(sequence, params), hashes(sequence, params));
+    }
+}
+
+TEST_F(minimiser_hash, invalid_parameters)
+{
+    sequence_t const sequence{random_sequence(100u)};
+
+    EXPECT_THROW(hashes(sequence, {.kmer_size = 33u, .window_size = 33u}), std::invalid_argument);
+    EXPECT_THROW(hashes(sequence, {.kmer_size = 19u, .window_size = 18u}), std::invalid_argument);
+    EXPECT_THROW(hashes(sequence, {.kmer_size = 19u, .window_size = 25u, .shape = 0b1101}), std::invalid_argument);
+    EXPECT_THROW(hashes(sequence, {.kmer_size = 19u, .window_size = 25u, .syncmer_size = 11u}), std::invalid_argument);
+    EXPECT_THROW(hashes(sequence, {.kmer_size = 19u, .window_size = 19u, .syncmer_size = 19u}),
+                 std::invalid_argument);
+}
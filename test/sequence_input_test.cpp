@@ -0,0 +1,155 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <seqan3/io/exception.hpp>
+
+#ifdef SEQAN3_HAS_ZLIB
+#    include <seqan3/contrib/stream/bgzf_ostream.hpp>
+#    include <seqan3/contrib/stream/gz_ostream.hpp>
+#endif
+
+#include <fpgalign/utility/sequence_input.hpp>
+
+#include "app_test.hpp"
+
+struct sequence_input : public app_test
+{
+    using record_t = std::pair<std::string, std::vector<uint8_t>>;
+
+    static std::filesystem::path write_file(std::filesystem::path const & path, std::string_view const content)
+    {
+        std::ofstream file{path, std::ios::binary};
+        file << content;
+        return path;
+    }
+
+    // The FM-index alphabet: A = 1, C = 2, G = 3, T = 4.
+    static std::vector<uint8_t> fm_ranks(std::string_view const sequence)
+    {
+        std::vector<uint8_t> ranks{};
+        for (char const c : sequence)
+            ranks.push_back(c == 'C' ? 2u : c == 'G' ? 3u : c == 'T' ? 4u : 1u);
+        return ranks;
+    }
+
+    // A FASTA file of many random records, such that the compressed file has several blocks.
+    static std::pair<std::string, std::vector<record_t>> random_fasta()
+    {
+        std::mt19937_64 engine{42u};
+        std::string content{};
+        std::vector<record_t> records{};
+        for (size_t i = 0; i < 10000u; ++i)
+        {
+            std::string sequence(100u, 'A');
+            for (char & base : sequence)
+                base = "ACGT"[engine() % 4u];
+            content += ">read" + std::to_string(i) + '\n' + sequence + '\n';
+            records.emplace_back("read" + std::to_string(i), fm_ranks(sequence));
+        }
+        return {std::move(content), std::move(records)};
+    }
+
+    static std::vector<record_t> read_all(std::filesystem::path const & path)
+    {
+        utility::sequence_input input{path};
+        std::vector<record_t> records{};
+        std::vector<uint8_t> sequence{};
+        while (input.next(sequence))
+        {
+            records.emplace_back(std::string{input.id()}, sequence);
+            sequence.clear();
+        }
+        return records;
+    }
+};
+
+TEST_F(sequence_input, fasta)
+{
+    std::vector<record_t> const expected{{"seq1 description", fm_ranks("ACGTTTGA")},
+                                         {"seq2", fm_ranks("TCGG")},
+                                         {"empty", {}},
+                                         {"seq3", fm_ranks("GATTACA")}};
+
+    EXPECT_EQ(read_all(write_file("multi_line.fasta",
+                                  ">seq1 description\nACGT\nTTGA\n>seq2\nTCGG\n>empty\n>seq3\nGATT\n\nACA")),
+              expected);
+    EXPECT_EQ(read_all(write_file("crlf.fasta",
+                                  ">seq1 description\r\nACGT\r\nTTGA\r\n>seq2\r\nTCGG\r\n"
+                                  ">empty\r\n>seq3\r\nGATTACA\r\n")),
+              expected);
+}
+
+TEST_F(sequence_input, fastq)
+{
+    // The second record repeats its ID on the `+` line and has qualities starting with `@` and `+`.
+    // The third record spans multiple lines.
+    std::vector<record_t> const expected{{"read1", fm_ranks("ACGT")},
+                                         {"read2", fm_ranks("GGC")},
+                                         {"read3", fm_ranks("TTAACC")}};
+
+    EXPECT_EQ(read_all(write_file("in.fastq",
+                                  "@read1\nACGT\n+\nIIII\n@read2\nGGC\n+read2\n@+I\n@read3\nTTA\nACC\n+\nIII\nIII\n")),
+              expected);
+    EXPECT_EQ(read_all(write_file("crlf.fastq", "@read1\r\nACGT\r\n+\r\nIIII\r\n@read2\r\nGGC\r\n+read2\r\n@+I\r\n"
+                                                "@read3\r\nTTA\r\nACC\r\n+\r\nIII\r\nIII")),
+              expected);
+}
+
+TEST_F(sequence_input, alphabet)
+{
+    // Lower case is accepted, U is read as T, and other characters (IUPAC) as A.
+    std::vector<record_t> const expected{{"seq", {1u, 2u, 3u, 4u, 4u, 4u, 1u, 1u, 1u, 1u}}};
+
+    EXPECT_EQ(read_all(write_file("in.fasta", ">seq\nacgtuUNRYn\n")), expected);
+}
+
+TEST_F(sequence_input, empty)
+{
+    EXPECT_TRUE(read_all(write_file("empty.fasta", "")).empty());
+    EXPECT_TRUE(read_all(write_file("newlines.fasta", "\n\n")).empty());
+}
+
+TEST_F(sequence_input, truncated_record)
+{
+    EXPECT_THROW(read_all(write_file("no_qualities.fastq", "@read1\nACGT\n+\nIIII\n@read2\nACGT\n")),
+                 seqan3::parse_error);
+    EXPECT_THROW(read_all(write_file("short_qualities.fastq", "@read1\nACGT\n+\nII")), seqan3::parse_error);
+    EXPECT_THROW(read_all(write_file("long_qualities.fastq", "@read1\nACGT\n+\nIIIII\n")), seqan3::parse_error);
+}
+
+TEST_F(sequence_input, invalid_format)
+{
+    EXPECT_THROW(read_all(write_file("in.txt", "ACGT\n")), seqan3::parse_error);
+    EXPECT_THROW(read_all(write_file("no_header.fastq", "@read1\nACGT\n+\nIIII\nACGT\n")), seqan3::parse_error);
+}
+
+#ifdef SEQAN3_HAS_ZLIB
+TEST_F(sequence_input, compressed)
+{
+    auto const [content, expected] = random_fasta();
+
+    {
+        std::ofstream file{"in.fasta.gz", std::ios::binary};
+        seqan3::contrib::gz_ostream stream{file};
+        stream << content;
+    }
+    {
+        std::ofstream file{"in.fasta.bgzf", std::ios::binary};
+        seqan3::contrib::bgzf_ostream stream{file};
+        stream << content;
+    }
+
+    EXPECT_EQ(read_all("in.fasta.gz"), expected);
+    EXPECT_EQ(read_all("in.fasta.bgzf"), expected);
+}
+#endif
@@ -0,0 +1,118 @@
+// SPDX-FileCopyrightText: 2006-2025 Knut Reinert & Freie Universität Berlin
+// SPDX-FileCopyrightText: 2016-2025 Knut Reinert & MPI für molekulare Genetik
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include <fpgalign/contrib/slotted_cart_queue.hpp>
+
+#include "app_test.hpp"
+
+struct slotted_cart_queue : public app_test
+{
+    using queue_t = scq::slotted_cart_queue<size_t>;
+
+    // The slot of the dequeued cart. The cart is returned to the queue.
+    static size_t slot_of(queue_t::cart_future_type cart)
+    {
+        EXPECT_TRUE(cart.valid());
+        return cart.get().first.value;
+    }
+};
+
+TEST_F(slotted_cart_queue, dequeue_order)
+{
+    // Each value fills a cart.
+    queue_t queue{{.slots = 3u, .carts = 3u, .capacity = 1u}};
+    for (size_t const slot : {0u, 1u, 2u})
+        queue.enqueue(scq::slot_id{slot}, slot);
+
+    // The last full cart is served first.
+    EXPECT_EQ(slot_of(queue.dequeue()), 2u);
+    EXPECT_EQ(slot_of(queue.dequeue()), 1u);
+    EXPECT_EQ(slot_of(queue.dequeue()), 0u);
+
+    queue.close();
+    EXPECT_FALSE(queue.dequeue().valid());
+    EXPECT_THROW(queue.enqueue(scq::slot_id{0u}, 0u), std::overflow_error);
+}
+
+TEST_F(slotted_cart_queue, preferred_slot)
+{
+    queue_t queue{{.slots = 4u, .carts = 4u, .capacity = 1u}};
+    for (size_t const slot : {0u, 1u, 2u, 3u})
+        queue.enqueue(scq::slot_id{slot}, slot);
+
+    EXPECT_EQ(slot_of(queue.dequeue(scq::slot_id{1u})), 1u);
+    EXPECT_EQ(slot_of(queue.dequeue(scq::slot_range{0u, 2u})), 0u);
+    // Without a full cart of the preferred slot, the fallback is served, and otherwise the next cart in order.
+    EXPECT_EQ(slot_of(queue.dequeue(scq::slot_id{1u}, scq::slot_range{2u, 3u})), 2u);
+    EXPECT_EQ(slot_of(queue.dequeue(scq::slot_id{1u})), 3u);
+}
+
+TEST_F(slotted_cart_queue, max_bypasses)
+{
+    queue_t queue{{.slots = 2u, .carts = 4u, .capacity = 1u, .max_bypasses = 2u}};
+    for (size_t const slot : {0u, 1u, 1u, 1u})
+        queue.enqueue(scq::slot_id{slot}, slot);
+
+    // After two carts were served ahead of the oldest cart, the oldest cart is served.
+    EXPECT_EQ(slot_of(queue.dequeue(scq::slot_id{1u})), 1u);
+    EXPECT_EQ(slot_of(queue.dequeue(scq::slot_id{1u})), 1u);
+    EXPECT_EQ(slot_of(queue.dequeue(scq::slot_id{1u})), 0u);
+    EXPECT_EQ(slot_of(queue.dequeue(scq::slot_id{1u})), 1u);
+}
+
+TEST_F(slotted_cart_queue, bounded_waiting)
+{
+    queue_t queue{{.slots = 3u, .carts = 8u, .capacity = 1u, .max_bypasses = 3u}};
+    queue.enqueue(scq::slot_id{0u}, 0u);
+    queue.enqueue(scq::slot_id{2u}, 2u);
+
+    // The preferred slot always has the newest cart. The carts of the other slots are still served, oldest first.
+    std::vector<size_t> served{};
+    for (size_t i = 0; i < 8u; ++i)
+    {
+        queue.enqueue(scq::slot_id{1u}, 1u);
+        served.push_back(slot_of(queue.dequeue(scq::slot_id{1u})));
+    }
+
+    EXPECT_EQ(served, (std::vector<size_t>{1u, 1u, 1u, 0u, 1u, 1u, 1u, 2u}));
+}
+
+TEST_F(slotted_cart_queue, flush)
+{
+    queue_t queue{{.slots = 2u, .carts = 2u, .capacity = 4u}};
+
+    std::vector<size_t> full_slots{};
+    queue.on_full_cart(
+        [&full_slots](scq::slot_id const slot)
+        {
+            full_slots.push_back(slot.value);
+        });
+
+    queue.enqueue(scq::slot_id{0u}, 10u);
+    queue.enqueue(scq::slot_id{0u}, 11u);
+    queue.enqueue(scq::slot_id{1u}, 20u);
+
+    // Flushing a slot without a cart does nothing.
+    queue.flush(scq::slot_id{0u});
+    queue.flush(scq::slot_id{0u});
+    EXPECT_EQ(full_slots, std::vector<size_t>{0u});
+
+    {
+        queue_t::cart_future_type cart = queue.dequeue();
+        ASSERT_TRUE(cart.valid());
+        auto [slot, values] = cart.get();
+        EXPECT_EQ(slot.value, 0u);
+        EXPECT_EQ(std::vector<size_t>(values.begin(), values.end()), (std::vector<size_t>{10u, 11u}));
+    }
+
+    // The partial cart of slot 1 is only delivered on close.
+    queue.close();
+    EXPECT_EQ(full_slots, (std::vector<size_t>{0u, 1u}));
+    EXPECT_EQ(slot_of(queue.dequeue()), 1u);
+    EXPECT_FALSE(queue.dequeue().valid());
+}